@@ -0,0 +1,48 @@
+#ifndef AFINES_DOMAINS_H
+#define AFINES_DOMAINS_H
+
+#include "globals.h"
+#include "box.h"
+
+class filament_ensemble;
+class motor_ensemble;
+
+// splits the box into nx by ny rectangular domains,
+// the layout of a spatial domain decomposition with one domain per process
+//
+// a domain owns the beads and motors inside it,
+// and needs copies of the springs of other domains within a halo around it
+// with Lees-Edwards boundaries, domains at the top and bottom of the box
+// are shifted by delrx against each other,
+// so their neighbors across the y boundary change as the box is sheared
+class domain_grid
+{
+    public:
+        domain_grid(box *bc, int nx, int ny, double halo);
+
+        int get_ndomains();
+
+        // domain of a position
+        int owner(vec_type pos);
+
+        // domains within the halo of domain d, other than d
+        void neighbors(int d, vector<int> &out);
+
+        // domains other than the owner whose halo contains the spring from r to r + disp
+        void halo_domains(vec_type r, vec_type disp, vector<int> &out);
+
+        // beads, motors and halo springs of every domain,
+        // and how unevenly they are distributed
+        void print_census(ostream &out, filament_ensemble *net, vector<motor_ensemble *> motors);
+
+    protected:
+        // domains overlapping the rectangle [lo, hi] or its periodic images
+        void overlapping(vec_type lo, vec_type hi, vector<int> &out);
+        void add_overlapping(vec_type lo, vec_type hi, vector<int> &out);
+
+        box *bc;
+        int nx, ny;
+        double halo;
+};
+
+#endif
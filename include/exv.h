@@ -5,6 +5,18 @@
 #include "quadrants.h"
 #include "box.h"
 
+class filament_ensemble;
+
+// force between a pair of springs within range
+// F acts on the nearest point of spring s, split between its beads by r_1 and r_2,
+// and -F acts on bead b of the other spring
+struct exv_contact
+{
+    int s, b;
+    double r, r_1, r_2;
+    vec_type F, dist;
+};
+
 class excluded_volume
 {
     public:
@@ -16,11 +28,14 @@ class excluded_volume
             pe_exv = 0.0;
         }
 
-        void update_spring_forces(vector<filament *> &network, int f);
-        void update_spring_forces_from_quads(quadrants *quads, vector<filament *> &network);
-        void update_force_between_filaments(
-                vector<filament *> &network, int n1, int l1, int n2, int l2);
-        void update_excluded_volume(vector<filament *> &network, int f);
+        void update_spring_forces(filament_ensemble *net, int f);
+        void update_spring_forces_from_quads(quadrants *quads, filament_ensemble *net);
+        // s1 and s2 are indices into the spring storage of net
+        void update_force_between_filaments(filament_ensemble *net, int s1, int s2);
+        // returns false if the springs are out of range
+        bool find_contact(filament_ensemble *net, int s1, int s2, exv_contact &c);
+        void apply_contact(filament_ensemble *net, const exv_contact &c);
+        void update_excluded_volume(filament_ensemble *net, int f);
 
         double get_pe_exv() { return pe_exv; }
         virial_type get_vir_exv() { return vir_exv; }
@@ -30,6 +45,9 @@ class excluded_volume
         double rmax, kexv;
         double pe_exv;
         virial_type vir_exv;
+
+        // contacts found by each block of pairs, applied in pair order
+        vector<vector<exv_contact>> contact_blocks;
 };
 
 #endif
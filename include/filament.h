@@ -12,8 +12,10 @@
 
 class filament_ensemble;
 
-#include "spring.h"
 #include "globals.h"
+#include "box.h"
+
+class motor_ensemble;
 
 class filament
 {
@@ -32,6 +34,11 @@ class filament
         string write_springs(int fil);
         string write_thermo(int fil);
 
+        // appends the rows of write_beads, write_springs and write_thermo
+        void copy_beads(int fil, vector<double> &out);
+        void copy_springs(int fil, vector<double> &out);
+        void copy_thermo(vector<double> &out);
+
         void print_thermo();
         string to_string();
 
@@ -43,32 +50,52 @@ class filament
         virial_type get_stretching_virial();
         virial_type get_bending_virial();
 
+        // springs off their rest length after the last projection of rigid links
+        int get_constraint_misses();
+
         // [state]
 
         int get_nbeads();
+        int get_offset();
         vec_type get_bead_position(int bead);
         vec_type get_force(int i);
 
         int get_nsprings();
-        spring *get_spring(int i);
+        double get_kl();
 
         double get_end2end();
 
         // [dynamics]
 
-        // updates bead and spring positions
-        // computes kinetic energies
+        // updates bead positions with noise drawn from each bead's stream for the current step
         // clears forces, but doesn't compute them
         void update_positions();
+        // the same, but with the stretching of springs integrated linearly implicitly,
+        // which stays stable for much larger dt * kl / damp
+        void update_positions_implicit();
+        void set_implicit_stretching(bool flag);
+        // the same, but springs are held at their rest lengths by constraint forces,
+        // which replace the spring forces (takes precedence over implicit stretching)
+        void update_positions_rigid();
+        void set_rigid_links(bool flag);
+        void set_dt(double dt);
+
+        // largest speed of a bead from its force, for adaptive steps
+        double get_max_drift();
+
+        // recomputes spring displacements, lengths, directions
+        // and arc lengths from the current bead positions
+        void update_springs();
 
         // shears beads and springs
         void update_d_strain(double);
 
         // attempts to fracture the filament
-        // failure: returns no filaments
-        // success: returns two filaments, split at the first fracture site
-        vector<filament *> try_fracture();
-        vector<filament *> fracture(int node);  // helper method
+        // failure: returns nullptr
+        // success: splits the filament at the first fracture site,
+        // keeps the lower half, and returns the upper half
+        filament *try_fracture();
+        filament *fracture(int node);  // helper method
         vector<vector<double>> get_beads(size_t first, size_t last);  // helper method
 
         void detach_all_motors();
@@ -103,18 +130,20 @@ class filament
 
         // [attached positions]
 
-        int new_attached(motor *m, int hd, int l, vec_type pos);
+        int new_attached(motor_ensemble *m, int mi, int hd, int l, vec_type pos);
         void del_attached(int i);
 
         int get_attached_l(int i);
         vec_type get_attached_pos(int i);
-        void add_attached_force(int i, vec_type f);
+        // adds the forces of the heads of m bound to this filament
+        void gather_attached_forces(motor_ensemble *m);
         void add_attached_pos(int i, double dist);
 
         bool at_barbed_end(int i);
         bool at_pointed_end(int i);
 
         double distance_from_pointed_end(int i, double pos);
+        double get_attached_distance(int i);
         double closest_attached_distance(int i, vec_type intpoint);
 
         // [growing settings]
@@ -125,23 +154,47 @@ class filament
         void set_lgrow(double);
 
     protected:
+        // makes room for at least n beads,
+        // moving them to a new range of bead storage if needed
+        void reserve_beads(int n);
+
+        // resets a piece of a fractured filament to the state of a new filament
+        void reset_piece(double l0);
+
+        // sorts the occupied slots of attached along the filament, if needed
+        void update_occupancy();
+        void clear_attached();
+
         box *bc;
         filament_ensemble *filament_network;
 
         // state
-        vector<vec_type> prv_rnds;
-        vector<class bead *> beads;
-        vector<spring *> springs;
+        // beads are stored by filament_network,
+        // in the range [offset, offset + nbeads) of its bead arrays
+        // spring i connects beads i and i + 1, and is stored at offset + i
+        int offset, nbeads, capacity;
 
-        struct attached_type { class motor *m; int hd; int l; double pos; };
+        // head hd of motor mi in ensemble m
+        struct attached_type { motor_ensemble *m; int mi; int hd; int l; double pos; };
         vector<attached_type> attached;
+        vector<int> free_attached;  // empty slots of attached
+
+        // {distance from pointed end, slot} of occupied slots of attached,
+        // sorted by distance
+        // rebuilt lazily, since springs and walking heads move every step
+        vector<pair<double, int>> occupancy;
+        bool occupancy_dirty;
 
         // thermo
         double ubend;
         virial_type bending_virial;
+        virial_type constraint_virial;  // of rigid links, from the last step
+        int constraint_misses;
 
         // parameters
-        double kb, temperature, dt, fracture_force, damp;
+        double rad, visc;
+        double kl, kb, temperature, dt, fracture_force, damp;
+        bool implicit_stretching, rigid_links;
 
         // growing parameters
         int nsprings_max;
@@ -28,17 +28,45 @@ class filament_ensemble
 
         // settings
         void set_external(external *);
+        void set_implicit_stretching(bool flag);
+        void set_rigid_links(bool flag);
+        void set_dt(double dt);
+        // frozen filaments only move by shear:
+        // they aren't integrated, motors don't add forces to them,
+        // and quadrants don't hold pairs for excluded volume
+        void set_frozen(bool flag);
 
         // quadrants
         quadrants *get_quads();
         void quad_update_serial();
+        void quad_update_parallel();
+
+        // incremental mode: springs are only moved between quadrants when they cross into new ones
+        void quad_update_incremental();
+        void set_quad_incremental(bool flag);
+        void quad_update();  // rebuilds or updates, depending on the mode and number of threads
+
+        // verlet mode: quadrants are built with a skin,
+        // and rebuilt only once a bead has moved more than half of it
+        // or the filaments have grown or fractured
+        void set_quad_skin(double skin);
+        bool quad_update_verlet();  // returns whether the quadrants were rebuilt
+        bool quads_expired();
+        int get_quad_rebuilds();
         vector<array<int, 2>> *get_attach_list(vec_type pos);
 
+        // frozen mode: quadrants are built once, and again only after shear moves the filaments,
+        // along with the geometry of every spring used by get_intpoint
+        // serial builds them like quad_update_serial, otherwise like quad_update
+        bool quad_update_frozen(bool serial);  // returns whether the quadrants were rebuilt
+
         // state
 
         int get_nbeads();
         int get_nsprings();
         int get_nfilaments();
+        // largest speed of a bead from its force, for adaptive steps
+        double get_max_drift();
 
         box *get_box();
         vector<filament *> * get_network();
@@ -46,22 +74,49 @@ class filament_ensemble
 
         vec_type get_force(int fil, int spring);
         vec_type get_direction(int fil, int spring);
+        vec_type get_disp(int fil, int spring);
         vec_type get_start(int fil, int spring);
         vec_type get_end(int fil, int spring);
+        vec_type get_intpoint(int fil, int spring, vec_type pos);
 
         double get_int_direction(int fil, int spring, double xp, double yp);
         double get_llength(int fil, int spring);
 
         bool is_polymer_start(int f, int a);
 
+        // bead storage
+        // each filament owns a contiguous range of these arrays,
+        // starting at filament::get_offset()
+        int allocate_beads(int n);
+        void release_beads(int offset, int n);
+        vec_type *get_positions();
+        vec_type *get_forces();
+        vec_type *get_prv_rnds();
+
+        // spring storage
+        // spring i connects beads i and i + 1 of the bead storage,
+        // so springs share the ranges of their filaments' beads
+        double *get_spring_l0s();
+        double *get_spring_lengths();
+        vec_type *get_spring_disps();
+        vec_type *get_spring_directions();
+        vec_type *get_spring_forces();
+        // arc length from the pointed end of the filament to bead i + 1
+        double *get_spring_arcs();
+
+        // nearest point on spring s to pos
+        vec_type intpoint(int s, vec_type pos);
+        bool line_intersect(int s1, int s2);
+
         // attached locations
-        fp_index_type new_attached(motor *m, int hd, int f_index, int l_index, vec_type pos);
+        fp_index_type new_attached(motor_ensemble *m, int mi, int hd, int f_index, int l_index, vec_type pos);
         void del_attached(fp_index_type i);
         array<int, 2> get_attached_fl(fp_index_type i);
         vec_type get_attached_pos(fp_index_type i);
-        void add_attached_force(fp_index_type i, vec_type f);
+        void gather_attached_forces(motor_ensemble *m);  // on all filaments
         void add_attached_pos(fp_index_type i, double dist);
         vec_type get_attached_direction(fp_index_type i);
+        double get_attached_distance(fp_index_type i);  // from the pointed end
         bool at_pointed_end(fp_index_type i);
         bool at_barbed_end(fp_index_type i);
 
@@ -76,6 +131,8 @@ class filament_ensemble
         virial_type get_stretching_virial();
         virial_type get_bending_virial();
         virial_type get_excluded_virial();
+        // springs of rigid links off their rest length after the last step
+        int get_constraint_misses();
         virial_type get_external_virial();
 
         // monte carlo
@@ -87,11 +144,20 @@ class filament_ensemble
 
         // dynamics
         void integrate();
+        void update_springs();
         void update_d_strain(double);
 
         // update forces/energies
         void compute_forces();
 
+        // multiple time steps: excluded volume and external forces are slow,
+        // and are computed every few steps and held in between,
+        // while stretching and bending are computed every step
+        void compute_slow_forces();
+        void compute_fast_forces();
+        void add_slow_forces();
+        bool slow_forces_expired();  // if filaments grew or fractured since the slow forces
+
         void update_stretching();
         void update_bending();
         void update_excluded_volume();
@@ -110,8 +176,13 @@ class filament_ensemble
         void write_springs(ofstream& fout);
         void write_thermo(ofstream& fout);
 
+        // the rows of the output files, flattened, for frame_type
+        void copy_beads(vector<double> &out);
+        void copy_springs(vector<double> &out);
+        void copy_thermo(vector<double> &out);
+
         void print_filament_thermo();
-        void print_network_thermo();
+        void print_network_thermo(ostream &out = cout);
         void print_filament_lengths();
 
     protected:
@@ -121,7 +192,44 @@ class filament_ensemble
         external *ext;
         vector<filament *> network;
 
+        // {offset, nbeads} of each filament
+        vector<array<int, 2>> get_layout();
+
+        // quadrants
+        void quads_built();
+
+        bool quad_incremental;
+        vector<array<int, 2>> quad_fl;  // labels and storage indices of springs, for quad_update_parallel
+        vector<int> quad_index;
+        double quad_skin;
+        int quad_rebuilds;
+        // bead positions, {offset, nbeads} of each filament and shear at the last build
+        vector<vec_type> quad_ref_pos;
+        vector<array<int, 2>> quad_ref_layout;
+        double quad_ref_delrx;
+
+        // frozen mode
+        // {rij_bc(end - start), squared length} of each spring, used by intpoint,
+        // and the shear they were computed at, while they are valid
+        bool frozen;
+        bool frozen_valid;
+        double frozen_delrx;
+        vector<vec_type> frozen_axis;
+        vector<double> frozen_l2;
+
+        // bead storage
+        vector<vec_type> bead_pos, bead_force, bead_prv_rnd;
+        vector<array<int, 2>> free_beads;  // released {offset, n} ranges, sorted by offset
+        vector<vec_type> bead_slow_force;
+        vector<array<int, 2>> slow_ref_layout;
+
+        // spring storage
+        vector<double> spring_l0, spring_len, spring_arc;
+        vector<vec_type> spring_disp, spring_direc, spring_force;
+
         // thermo
+        vector<double> fil_pe_stretch, fil_pe_bend;
+        vector<virial_type> fil_vir_stretch, fil_vir_bend;
         double pe_stretch, pe_bend, pe_exv, pe_ext;
         virial_type vir_stretch, vir_bend, vir_exv, vir_ext;
 };
@@ -49,6 +49,10 @@
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #include "vec.h"
 
 using namespace std;
@@ -63,12 +67,39 @@ const double eps = 1e-4;
 const double infty = 1e10;
 const double actin_mass_density = 2.6e-14; //miligram / micron
 /*generic functions to be used below*/
+
+// random numbers come from a counter-based generator (Philox4x32-10),
+// so every draw is a pure function of (seed, step, particle id, purpose)
+// and doesn't depend on the order of draws or the number of threads
+// the whole state of the generator is the seed and the step
 void set_seed(int s);
+int get_seed();
+void set_rng_step(uint64_t step);
+uint64_t get_rng_step();
+
+// what a stream of random numbers is used for
+// ensembles with several instances (e.g. motors) add a tag in the upper 16 bits
+enum rng_purpose : uint32_t {
+    rng_sequential,
+    rng_bead_init,
+    rng_bead_noise,
+    rng_bead_reset,
+    rng_bead_grow,
+    rng_filament_grow,
+    rng_head_init,
+    rng_head_noise,
+    rng_attach_detach,
+    rng_motor_order,
+    rng_spring_noise,
+};
+uint32_t new_rng_tag();
+
+// setup code that draws sequentially, such as generating initial configurations,
+// uses one stream that runs from set_seed
 double rng_u();
 int pr(int num);
 double rng_exp(double mean);
 double rng_n(); //default parameters --> mu = 0, sig = 1
-mt19937_64 &get_rng();
 
 vector<int> range_bc(string bc, double delrx, int botq, int topq, int low, int high);
 vector<int> range_bc(string bc, double delrx, int botq, int topq, int low, int high, int di);
@@ -120,6 +151,155 @@ void intarray_printer(array<int,2> a);
 boost::optional<vec_type> seg_seg_intersection(vec_type, vec_type, vec_type, vec_type);
 std::string quads_error_message(std::string, vector<array<int, 2> >, vector<array<int, 2> > );
 
+// threads run by parallel regions
+// without OpenMP, everything runs on the calling thread
+inline void set_num_threads(int n)
+{
+#ifdef _OPENMP
+    omp_set_num_threads(n);
+#else
+    if (n > 1) cerr << "Warning: built without OpenMP, running on 1 thread." << endl;
+#endif
+}
+
+inline int get_max_threads()
+{
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+inline int get_num_threads()
+{
+#ifdef _OPENMP
+    return omp_get_num_threads();
+#else
+    return 1;
+#endif
+}
+
+inline int get_thread_num()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+// levels of nested parallel regions that get more than one thread
+inline void set_max_active_levels(int n)
+{
+#ifdef _OPENMP
+    omp_set_max_active_levels(n);
+#else
+    (void)n;
+#endif
+}
+
+class rng_stream
+{
+    public:
+        // stream of particle id for purpose at the current step
+        rng_stream(uint32_t purpose, uint32_t id) : rng_stream(purpose, id, get_rng_step()) {}
+
+        rng_stream(uint32_t purpose, uint32_t id, uint64_t step)
+        {
+            key = {uint32_t(get_seed()), purpose};
+            ctr = {0, id, uint32_t(step), uint32_t(step >> 32)};
+            used = 4;
+            has_normal = false;
+        }
+
+        // uniform in (0, 1)
+        double u()
+        {
+            uint32_t a = this->next();
+            uint32_t b = this->next();
+            uint64_t k = (uint64_t(a >> 5) << 26) | (b >> 6);
+            return (k + 0.5) * (1.0 / 9007199254740992.0);
+        }
+
+        // standard normal, by Box-Muller
+        double n()
+        {
+            if (has_normal) {
+                has_normal = false;
+                return normal;
+            }
+            double r = sqrt(-2.0 * log(this->u()));
+            double theta = 2.0 * pi * this->u();
+            normal = r * sin(theta);
+            has_normal = true;
+            return r * cos(theta);
+        }
+
+        vec_type vec_n()
+        {
+            double x = this->n();
+            double y = this->n();
+            return {x, y};
+        }
+
+    private:
+        uint32_t next()
+        {
+            if (used == 4) {
+                block = philox(ctr, key);
+                ctr[0]++;
+                used = 0;
+            }
+            return block[used++];
+        }
+
+        static array<uint32_t, 4> philox(array<uint32_t, 4> c, array<uint32_t, 2> k)
+        {
+            for (int round = 0; round < 10; round++) {
+                uint64_t p0 = uint64_t(0xD2511F53) * c[0];
+                uint64_t p1 = uint64_t(0xCD9E8D57) * c[2];
+                c = {uint32_t(p1 >> 32) ^ c[1] ^ k[0], uint32_t(p1),
+                     uint32_t(p0 >> 32) ^ c[3] ^ k[1], uint32_t(p0)};
+                k[0] += 0x9E3779B9;
+                k[1] += 0xBB67AE85;
+            }
+            return c;
+        }
+
+        array<uint32_t, 2> key;
+        array<uint32_t, 4> ctr, block;
+        int used;
+        bool has_normal;
+        double normal;
+};
+
+// everything random numbers depend on
+// a process runs one simulation with one state,
+// but a thread can bind a state of its own to run a simulation independent of others,
+// if that simulation runs on this thread only
+struct rng_state
+{
+    rng_state();
+
+    int seed;
+    uint64_t step;
+    uint32_t ntags;
+    rng_stream sequential;
+};
+void bind_rng_state(rng_state *state);  // null goes back to the state of the process
+
+// deterministic shuffle of v for the current step
+template <typename T>
+void rng_shuffle(vector<T> &v, uint32_t id)
+{
+    rng_stream rng(rng_motor_order, id);
+    for (size_t i = v.size(); i > 1; i--) {
+        size_t j = size_t(rng.u() * i);
+        std::swap(v[i - 1], v[j]);
+    }
+}
+
 inline vec_type vec_randn()
 {
     // separate statements to keep call order correct
@@ -130,9 +310,10 @@ inline vec_type vec_randn()
 
 struct mc_prob
 {
-    mc_prob()
+    // u is uniform in [0, 1)
+    mc_prob(double u)
     {
-        prob = rng_u();
+        prob = u;
         used = 0.0;
     }
 
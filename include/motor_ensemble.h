@@ -1,6 +1,6 @@
 /*
  * motor.h
- *  
+ *
  *
  *  Created by Shiladitya Banerjee on 9/3/13.
  *  Copyright 2013 University of Chicago. All rights reserved.
@@ -10,6 +10,11 @@
 #ifndef AFINES_MOTOR_ENSEMBLE_H
 #define AFINES_MOTOR_ENSEMBLE_H
 
+class filament_ensemble;
+
+#include "globals.h"
+#include "box.h"
+#include "ext.h"
 #include "motor.h"
 
 class motor_ensemble
@@ -22,9 +27,7 @@ class motor_ensemble
                 double fstall, double rcut, double vis);
         ~motor_ensemble();
 
-        void add_motor(motor *m);
         int get_nmotors();
-        motor *get_motor(int);
 
         // [settings]
         void set_binding_two(double, double, double);
@@ -41,15 +44,52 @@ class motor_ensemble
         void set_velocity(double v1, double v2);
         void set_stall_force(double f1, double f2);
         void set_occ(double occ);
+        // time between attach/detach attempts, dt unless they don't run every step
+        void set_binding_interval(double interval);
+        // also sets the binding interval
+        void set_dt(double dt);
+
+        // [state] of motor i
+        array<motor_state, 2> get_states(int i);
+        vec_type get_h0(int i);
+        vec_type get_h1(int i);
+        array<int, 2> get_f_index(int i);
+        array<int, 2> get_l_index(int i);
+        array<double, 2> get_contour_pos(int i);  // distance from pointed end, NAN if unbound
+        array<vec_type, 2> get_force(int i);
+        // forces on the spring bound to head hd, zero if it isn't bound:
+        // the head force, applied at the head by the lever rule,
+        // and a couple, applied as -f on the first bead of the spring and f on the second
+        array<vec_type, 2> get_filament_forces(int i, int hd);
+
+        // for adaptive steps:
+        // largest speed of a head, from its force if free, or walking if bound
+        double get_max_drift();
+        // largest attach/detach rate, 0 without motors
+        double get_max_rate();
 
         // [dynamics]
         void try_attach_detach();  // attach/detach all motors
         void try_attach_detach(int i);  // attach/detach a single motor
+        // attach/detach in two passes:
+        // moves of all motors are proposed in parallel, without changing filaments,
+        // then the move of each motor is committed (occlusion is checked on commit)
+        void propose_attach_detach();
+        bool has_move(int i);
+        void commit_attach_detach(int i);
         void integrate();  // brownian/walk
+        void integrate_free();  // brownian, for free heads only
+        void integrate_bound();  // walk, for bound heads, after filaments move
         void update_d_strain(double g);  // shear
         void compute_forces();  // compute force/energy/virial
+        void update_head_forces();  // forces of all motors, without adding them to filaments
+        void gather_forces();  // add forces to filaments, after their own forces
         void update_energies();  // compute energy/virial
 
+        // detach head hd of motor i, and leave it at the same position
+        // (called by filaments that are removed)
+        void detach_head_without_moving(int i, int hd);
+
         // [thermo]
         // calculated by update_energies
 
@@ -67,23 +107,124 @@ class motor_ensemble
         virial_type get_external_virial();
 
         // [output]
-        void print_ensemble_thermo();
+        void print_ensemble_thermo(ostream &out = cout);
         vector<vector<double>> output();
         void motor_write(ostream &fout);
         void motor_write_doubly_bound(ostream &fout);
+        // the rows of motor_write, flattened, for frame_type
+        void copy_output(vector<double> &out);
         // void motor_tension(ofstream& fout);
 
     protected:
+
+        // [forces] of motor i
+        void update_force(int i);  // updates all forces
+        void update_bending(int i, int hd);  // compute bending forces
+        void update_alignment(int i);  // compute alignment forces
+        void update_external(int i, int hd);  // compute external forces
+        void update_force_proj(int i, int hd);  // compute projected forces for walking
+        void update_load_cost();  // estimated cost of each motor, for balanced_for
+
+        // [dynamics] of motor i
+        void relax_head(int i, int hd);
+        void brownian_relax(int i, int hd);  // Brownian dynamics for free heads
+        void walk(int i, int hd);  // walking for bound heads
+        void step(int i);  // compute derived state (incl. bound head positions)
+
+        // [attach/detach] of motor i
+        void propose_attach_detach(int i);
+        double metropolis_prob(int i, int hd, array<int, 2> fl_idx, vec_type newpos);
+        double alignment_penalty(vec_type a, vec_type b);
+        bool try_attach(int i, int hd, mc_prob &p);
+        bool allowed_bind(int i, int hd, array<int, 2> fl_idx);
+        void attach_head(int i, int hd, vec_type intpoint, array<int, 2> fl);
+        bool try_detach(int i, int hd, mc_prob &p);
+        vec_type generate_off_pos(int i, int hd);
+        void detach_head(int i, int hd, vec_type pos);
+
+        // [output] of motor i
+        vector<double> output(int i);
+        string write(int i);
+
+        box *bc;
         filament_ensemble *f_network;
-        vector<motor *> n_motors;
 
-        double mld;  // saved for set_bending
-        external *ext;  // saved for deletion in destructor
+        // [parameters]
+        // shared by all motors in the ensemble
+
+        double dt, temperature, damp;
+        double bd_prefactor;
+
+        // attach/detach
+        // rates, and probabilities per attempt
+        double ron, roff, rend, ron2, roff2, rend2;
+        double binding_interval;
+        double kon, koff, kend;
+        double kon2, koff2, kend2;
+        double max_bind_dist, max_bind_dist_sq;
+        double occ;
+
+        // walk
+        array<double, 2> vs, stall_force;
+
+        // stretch
+        double mk, mld;
+
+        // bend
+        double kb, th0;
+
+        // align
+        double kalign;
+        int par_flag;
+
+        // external
+        external *ext;
 
         // flags
         bool shear_flag, static_flag;
 
-        // thermo
+        // added to the purpose of random streams
+        uint32_t rng_tag;
+
+        // [state]
+        // one entry per motor, and per head where needed
+
+        // head state
+        vector<array<motor_state, 2>> state;
+        vector<array<vec_type, 2>> h;  // for bound, updated by step
+        // unbound only
+        vector<array<vec_type, 2>> prv_rnd;
+        // bound only
+        vector<array<fp_index_type, 2>> fp_index;  // location bound
+        vector<array<vec_type, 2>> ldir_bind, bind_disp;  // for unbinding
+
+        // move proposed by propose_attach_detach, hd is -1 if none
+        // head hd attaches to spring fl at pos, or detaches to pos
+        struct motor_move { int hd; bool attach; vec_type pos; array<int, 2> fl; };
+        vector<motor_move> moves;
+
+        vector<double> load_cost;
+
+        // [derived] from state
+        vector<double> len;
+        vector<vec_type> disp, direc;
+
+        // [forces] computed from state and derived
+        vector<array<vec_type, 2>> force;
+        vector<array<vec_type, 2>> s_force;
+        vector<array<vec_type, 2>> b_force;
+        vector<array<vec_type, 2>> fil_force;  // bending and alignment couple on the bound spring
+        vector<array<vec_type, 2>> ext_force;
+        vector<array<double, 2>> f_proj;
+
+        // [thermo] computed along with forces
+        vector<double> s_eng;
+        vector<array<double, 2>> b_eng;
+        vector<double> align_eng;
+        vector<array<double, 2>> ext_eng;
+        vector<virial_type> m_vir_stretch, m_vir_bend, m_vir_align, m_vir_ext;
+
+        // [thermo] totals, calculated by update_energies
         double pe_stretch, pe_bend, pe_align, pe_ext, pe_bind;
         virial_type vir_stretch, vir_bend, vir_align, vir_ext;
 };
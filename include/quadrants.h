@@ -3,7 +3,6 @@
 
 #include "globals.h"
 #include "box.h"
-#include "spring.h"
 
 class quadrants {
     public:
@@ -11,8 +10,29 @@ class quadrants {
         ~quadrants();
         void use_quad(bool flag);
 
-        void add_spring(spring *s, array<int, 2> fl);
+        // pads every spring by skin / 2 on each side when binning it,
+        // so the quadrants stay valid until a bead moves more than skin / 2
+        void set_skin(double skin);
+
+        // h0 and h1 are the ends of spring fl, and disp = h1 - h0 under the boundary conditions
+        void add_spring(vec_type h0, vec_type h1, vec_type disp, array<int, 2> fl);
+
+        // adds springs fl[i], from pos[index[i]] to pos[index[i] + 1] with displacement disp[index[i]],
+        // using all threads, with the same result as adding them one by one in order
+        void add_springs(const vector<array<int, 2>> &fl, const vector<int> &index,
+                const vec_type *pos, const vec_type *disp);
+
+        // incremental updates, with springs identified by a stable id
+        // springs are only moved between quadrants whose set of quadrants changed,
+        // and springs not updated since begin_update are removed by end_update
+        void begin_update();
+        void update_spring(int id, vec_type h0, vec_type h1, vec_type disp, array<int, 2> fl);
+        void remove_spring(int id);
+        void end_update();
+
         vector<array<int, 2>> *get_attach_list(vec_type pos);
+        // each pair of springs sharing a quadrant, exactly once and sorted by spring id
+        // (f, l) order when springs were added with add_spring
         void build_pairs();
         vector<array<array<int, 2>, 2>> *get_pairs();
         void clear();
@@ -23,16 +43,44 @@ class quadrants {
         void check_duplicates();
 
     protected:
-        void add_spring_nonperiodic(spring *, array<int, 2>);
-        void add_spring_periodic(spring *, array<int, 2>);
+        array<double, 4> find_bounds(vec_type h0, vec_type h1, vec_type disp);
+        array<int, 4> find_range(const array<double, 4> &bounds);
+        bool range_is_exact(const array<int, 4> &range);
+
+        // appends the quadrants (x * nq[1] + y) covered by a spring to cells
+        void find_cells(const array<double, 4> &bounds, const array<int, 4> &range, vector<int> &cells);
+        void find_cells_nonperiodic(array<int, 4> range, vector<int> &cells);
+        void find_cells_periodic(const array<double, 4> &bounds, const array<int, 4> &range, vector<int> &cells);
+
+        void insert(int id);
+        void erase(int id);
+        void relabel(int id, array<int, 2> fl);
+
+        // a pair is owned by the first quadrant of spring a that also holds spring b
+        bool owns_pair(int a, int b, int cell);
 
         box *bc;
         array<int, 2> nq;
         bool quad_flag;
+        double pad;
         vector<array<int, 2>> all_springs;
         vector<array<int, 2>> **quads;
         vector<array<array<int, 2>, 2>> pairs;
-        unordered_set<array<array<int, 2>, 2>, boost::hash<array<array<int, 2>, 2>>> pairset;
+        vector<vector<array<array<int, 2>, 2>>> pair_blocks;
+        bool pairs_dirty;
+
+        // per spring id: its label ({-1, -1} if absent), its quadrant range before wrapping,
+        // the quadrants it covers, and the last update it was seen in
+        vector<array<int, 2>> spring_fl;
+        vector<array<int, 4>> spring_range;
+        vector<vector<int>> spring_cells;
+        vector<int> spring_seen;
+        int nsprings, update_count;
+        vector<int> scratch_cells;
+
+        // spring ids per quadrant, parallel to quads
+        vector<vector<int>> cell_springs;
+        vector<int> cell_counts;  // per thread and quadrant, for add_springs
 };
 
 #endif
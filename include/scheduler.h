@@ -0,0 +1,66 @@
+#ifndef AFINES_SCHEDULER_H
+#define AFINES_SCHEDULER_H
+
+#include "globals.h"
+
+#include <chrono>
+
+// load-balanced parallel loops
+//
+// a loop over n items is split into blocks of about equal estimated cost,
+// several per thread, and threads take blocks dynamically,
+// so a thread that finishes early takes blocks left by a thread on a dense cluster
+//
+// each loop records the busy time of every thread, and its wall time,
+// so that idle time (wall time minus busy time) can be reported per thread
+
+enum load_phase {
+    load_motor_forces,
+    load_attach_detach,
+    load_exv,
+    load_nphases
+};
+
+// splits [0, n) into nblocks blocks of about equal total cost,
+// bounds gets nblocks + 1 entries
+// cost[i] is the estimated cost of item i, or every item costs the same if cost is null
+void balanced_blocks(int n, const double *cost, int nblocks, vector<int> &bounds);
+
+// number of blocks of a balanced loop,
+// several per thread, so that blocks are small enough to even out dense clusters
+int get_nblocks();
+
+double wall_time();  // seconds
+// adds the wall time and per-thread busy time of one loop
+void add_load(load_phase phase, double wall, const vector<double> &busy);
+
+// busy and idle time of each thread in every phase
+void print_load_balance(ostream &out);
+
+// runs body(block, first, last) for the blocks of [0, n)
+// blocks are numbered in order, so per-block results can be combined in order
+template <typename F>
+void balanced_for(load_phase phase, int n, const double *cost, F body)
+{
+    int nthreads = get_max_threads();
+    int nblocks = get_nblocks();
+    vector<int> bounds;
+    balanced_blocks(n, cost, nblocks, bounds);
+
+    vector<double> busy(nthreads, 0.0);
+    double start = wall_time();
+    #pragma omp parallel
+    {
+        double &my_busy = busy[get_thread_num()];
+
+        #pragma omp for schedule(dynamic, 1) nowait
+        for (int blk = 0; blk < nblocks; blk++) {
+            double t = wall_time();
+            body(blk, bounds[blk], bounds[blk + 1]);
+            my_busy += wall_time() - t;
+        }
+    }
+    add_load(phase, wall_time() - start, busy);
+}
+
+#endif
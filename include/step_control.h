@@ -0,0 +1,39 @@
+#ifndef AFINES_STEP_CONTROL_H
+#define AFINES_STEP_CONTROL_H
+
+#include "globals.h"
+
+// chooses the dt of every step of an adaptive run
+//
+// steps are sized before they are taken, from the forces at the start of the step,
+// so that no bead or motor head drifts more than tol in a step,
+// and attach/detach probabilities (rate * dt) stay small
+// dt shrinks at once when forces spike, and grows by at most max_growth per step,
+// within [dt_min, dt_max]
+// a step that would pass the next output time is cut short to end on it,
+// without changing the dt that later steps grow from
+class step_control
+{
+    public:
+        step_control(double dt, double dt_min, double dt_max, double tol);
+
+        // dt of the next step
+        // max_drift: largest velocity from forces and walking (um/s)
+        // max_rate: largest attach/detach rate (1/s)
+        // time_left: time to the next output
+        double next(double max_drift, double max_rate, double time_left);
+
+        // steps, range of dt, and how often it shrank or was cut short
+        void print_summary(ostream &out);
+
+        static constexpr double max_growth = 1.2;
+        static constexpr double max_prob = 0.1;
+
+    protected:
+        double dt, dt_min, dt_max, tol;
+
+        long nsteps, nshrunk, ncut;
+        double dt_lo, dt_hi, elapsed;
+};
+
+#endif
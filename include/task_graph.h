@@ -0,0 +1,66 @@
+#ifndef AFINES_TASK_GRAPH_H
+#define AFINES_TASK_GRAPH_H
+
+#include "globals.h"
+
+#include <functional>
+
+// a simulation step as a graph of tasks
+//
+// tasks run in waves: a task runs in the first wave after all of its dependencies,
+// tasks in the same wave run at the same time, each with a share of the threads
+// for its own parallel loops, and a task that runs alone gets all threads
+// tasks in a wave must not write data that other tasks in the wave use
+//
+// every run can be traced
+// the achieved critical path is the slowest task of every wave,
+// and the longest chain of dependencies shows what a schedule without waves could reach
+class task_graph
+{
+    public:
+        task_graph();
+
+        // returns the id of the task
+        // deps are ids of tasks added before
+        int add(string name, function<void()> run, vector<int> deps = {});
+
+        // runs every task once
+        void run();
+
+        // writes the timings of the first nsteps runs to out
+        void set_trace(ostream *out, long nsteps);
+
+        // how often each task was on the critical path, and for how long
+        void print_summary(ostream &out);
+
+    protected:
+        struct task_type
+        {
+            string name;
+            function<void()> run;
+            vector<int> deps;
+            int wave;
+
+            // last run
+            double start, end;
+            int nthreads;
+
+            // totals over all runs
+            double time;
+            long ncritical;
+        };
+
+        void run_wave(const vector<int> &wave);
+        void trace_run(double start, double end);
+
+        vector<task_type> tasks;
+        vector<vector<int>> waves;
+
+        ostream *trace_out;
+        long trace_steps;
+
+        long nruns;
+        double run_time, critical_time, dependency_time;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef AFINES_TRAJECTORY_WRITER_H
+#define AFINES_TRAJECTORY_WRITER_H
+
+#include "globals.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// the output of one frame, copied out of the simulation
+// rows of every file are flattened, with ncols values per row
+struct frame_type
+{
+    string time_str;
+
+    vector<double> beads;     // x, y, radius, filament
+    vector<double> springs;   // x, y, dx, dy, filament
+    vector<double> myosins;   // x, y, dx, dy, filament and bead of each head
+    vector<double> crosslks;  // x, y, dx, dy, filament and bead of each head
+    vector<double> thermo;    // stretching and bending energy of each filament
+    vector<double> pe;        // one line of pe.txt
+};
+
+enum frame_file {
+    frame_beads,
+    frame_springs,
+    frame_myosins,
+    frame_crosslks,
+    frame_thermo,
+    frame_pe,
+    frame_nfiles
+};
+
+// writes frames to the output files
+//
+// with a queue depth of 0, frames are written when they are pushed
+// otherwise a background thread formats and writes them,
+// while the step loop fills the next frame
+// up to depth frames wait for the thread, and the step loop waits for a free frame
+// when the queue is full, so that output can't fall arbitrarily far behind
+//
+// frames are written in order, with the same text in both modes
+class trajectory_writer
+{
+    public:
+        trajectory_writer(array<ostream *, frame_nfiles> files, int depth);
+        ~trajectory_writer();
+
+        // a frame to fill, which is written by push()
+        frame_type &next();
+        void push();
+
+        // writes all queued frames
+        void finish();
+
+        // frames written, and seconds the step loop waited for a free frame
+        void print_summary(ostream &out);
+
+    protected:
+        void write(const frame_type &frame);
+        void run();
+
+        array<ostream *, frame_nfiles> files;
+        int depth;
+
+        vector<frame_type> frames;
+        vector<int> free_frames;
+        deque<int> queued;
+        int current;
+
+        std::thread thread;
+        std::mutex lock;
+        std::condition_variable changed;
+        bool done;
+        string error;
+
+        long nframes;
+        double wait_time;
+};
+
+#endif
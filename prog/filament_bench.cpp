@@ -0,0 +1,83 @@
+#include "filament_ensemble.h"
+#include "globals.h"
+#include "generate.h"
+
+#include <chrono>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+
+// times the filament integrate and force loops
+// and reports the cost per bead per timestep
+int main(int argc, char **argv)
+{
+    int npolymer, nmonomer, nsteps, myseed, threads;
+    double xrange, yrange, dt, temperature, viscosity;
+    double actin_length, link_length, link_stretching_stiffness, polymer_bending_modulus;
+
+    po::options_description config("Filament Benchmark Options");
+    config.add_options()
+        ("help,h", "produce help message")
+        ("npolymer", po::value<int>(&npolymer)->default_value(20000), "number of polymers in the network")
+        ("nmonomer", po::value<int>(&nmonomer)->default_value(11), "number of monomers per filament")
+        ("nsteps", po::value<int>(&nsteps)->default_value(100), "number of timesteps to time")
+        ("myseed", po::value<int>(&myseed)->default_value(1), "Random number generator myseed")
+        ("threads", po::value<int>(&threads)->default_value(1), "number of threads")
+        ("xrange", po::value<double>(&xrange)->default_value(100), "size of cell in horizontal direction (um)")
+        ("yrange", po::value<double>(&yrange)->default_value(100), "size of cell in vertical direction (um)")
+        ("dt", po::value<double>(&dt)->default_value(0.0001), "length of individual timestep in seconds")
+        ("temperature,temp", po::value<double>(&temperature)->default_value(0.004), "Temp in kT [pN-um]")
+        ("viscosity", po::value<double>(&viscosity)->default_value(0.001), "Dynamic viscosity [mg / (um*s)]")
+        ("actin_length", po::value<double>(&actin_length)->default_value(0.5), "Length of a single actin monomer")
+        ("link_length", po::value<double>(&link_length)->default_value(1), "Length of links connecting monomers")
+        ("link_stretching_stiffness,ks", po::value<double>(&link_stretching_stiffness)->default_value(1), "stiffness of link, pN/um")
+        ("polymer_bending_modulus", po::value<double>(&polymer_bending_modulus)->default_value(0.068), "Bending modulus of a filament")
+        ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, config), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << config << "\n";
+        return 1;
+    }
+
+    double link_bending_stiffness = polymer_bending_modulus / link_length;
+
+    box *bc = new box("PERIODIC", xrange, yrange, 0.0);
+    set_seed(myseed);
+    set_num_threads(threads);
+
+    vector<vector<double>> actin_pos_vec = generate_filament_ensemble(
+            bc, npolymer, nmonomer, 0, 0.0,
+            dt, temperature, actin_length, link_length,
+            {}, link_bending_stiffness, myseed);
+
+    filament_ensemble *net = new filament_ensemble(
+            bc, actin_pos_vec, {1, 1}, dt,
+            temperature, viscosity, link_length,
+            link_stretching_stiffness, link_bending_stiffness,
+            1e8, 0.25, 0.0);
+
+    net->compute_forces();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int count = 0; count < nsteps; count++) {
+        set_rng_step(count);
+        net->integrate();
+        net->compute_forces();
+    }
+    auto stop = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    double nbead_steps = double(net->get_nbeads()) * nsteps;
+    fmt::print("filaments: {}\tbeads: {}\tsteps: {}\tthreads: {}\n",
+            net->get_nfilaments(), net->get_nbeads(), nsteps, get_max_threads());
+    fmt::print("total: {} s\tper bead-step: {} ns\n", ns * 1e-9, ns / nbead_steps);
+
+    delete net;
+    delete bc;
+
+    return 0;
+}
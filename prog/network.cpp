@@ -2,13 +2,20 @@
 #include "motor_ensemble.h"
 #include "globals.h"
 #include "generate.h"
+#include "scheduler.h"
+#include "task_graph.h"
+#include "trajectory_writer.h"
+#include "domains.h"
+#include "step_control.h"
 
 #include <iostream>
 #include <fstream>
 #include <iterator>
 #include <array>
+#include <atomic>
 #include <boost/program_options.hpp>
 #include <boost/any.hpp>
+#include <boost/algorithm/string.hpp>
 #include <typeinfo>
 
 namespace po = boost::program_options;
@@ -20,13 +27,9 @@ ostream& operator<<(ostream& os, const vector<T>& v)
     return os;
 }
 
-ostream &operator<<(ostream &os, const virial_type &a)
-{
-    fmt::print(os, "{}\t{}\t{}\t{}", a.xx, a.xy, a.yx, a.yy);
-    return os;
-}
-
-int main(int argc, char **argv)
+// runs one simulation, with progress printed to out
+// nsteps is the number of steps run
+static int run_simulation(const vector<string> &args, ostream &out, long &nsteps)
 {
     // BEGIN PROGRAM OPTIONS
 
@@ -37,6 +40,8 @@ int main(int argc, char **argv)
         ("version,v", "print version string")
         ("help,h", "produce help message")
         ("config,c", po::value<string>(&config_file)->default_value("config/network.cfg"), "name of a configuration file")
+        ("sweep", po::value<string>(), "file of parameters to sweep, with a comma-separated list of values per line (name=value1,value2,...); "
+            "every combination runs as a replica in dir/replica_<n>, with threads replicas at a time")
         ;
 
     // environment
@@ -45,6 +50,8 @@ int main(int argc, char **argv)
     double xrange, yrange;
 
     double dt, tinit, tfinal;
+    int mts_ratio;
+    double dt_tol, dt_min, dt_max;
     int nframes, nmsgs;
 
     double viscosity, temperature;
@@ -61,6 +68,14 @@ int main(int argc, char **argv)
     double grid_factor;
     bool quad_off_flag;
     int quad_update_period;
+    double quad_skin;
+    bool quad_incremental_flag;
+
+    int threads;
+    int task_trace_steps;
+    int output_queue_depth;
+    int domains_x, domains_y;
+    double domain_halo;
 
     bool circle_flag; double circle_radius, circle_spring_constant;
 
@@ -71,6 +86,10 @@ int main(int argc, char **argv)
         ("yrange", po::value<double>(&yrange)->default_value(10), "size of cell in vertical direction (um)")
 
         ("dt", po::value<double>(&dt)->default_value(0.0001), "length of individual timestep in seconds")
+        ("mts_ratio", po::value<int>(&mts_ratio)->default_value(1), "number of timesteps between updates of the slow work (filament excluded volume and external forces, quadrants, motor attach/detach), whose forces are held in between")
+        ("dt_tol", po::value<double>(&dt_tol)->default_value(0), "if > 0, dt adapts every step, starting from dt, so that no bead or motor head drifts further than this (um) in a step; frames stay evenly spaced in time")
+        ("dt_min", po::value<double>(&dt_min)->default_value(0), "smallest adaptive dt, dt/100 if 0")
+        ("dt_max", po::value<double>(&dt_max)->default_value(0), "largest adaptive dt, 10 dt if 0")
         ("tinit", po::value<double>(&tinit)->default_value(0), "time that recording of simulation starts")
         ("tfinal", po::value<double>(&tfinal)->default_value(0.01), "length of simulation in seconds")
         ("nframes", po::value<int>(&nframes)->default_value(1000), "number of times between actin/link/motor positions to are printed to file")
@@ -93,6 +112,14 @@ int main(int argc, char **argv)
         ("grid_factor", po::value<double>(&grid_factor)->default_value(2), "number of grid boxes per um^2")
         ("quad_off_flag", po::value<bool>(&quad_off_flag)->default_value(false), "flag to turn off neighbor list updating")
         ("quad_update_period", po::value<int>(&quad_update_period)->default_value(1), "number of timesteps between actin/link/motor position updates to update quadrants")
+        ("quad_skin", po::value<double>(&quad_skin)->default_value(0), "if > 0, skin distance (um) of quadrants, which are then rebuilt only when a bead has moved more than half of it, ignoring quad_update_period")
+        ("quad_incremental_flag", po::value<bool>(&quad_incremental_flag)->default_value(false), "flag to move only springs that cross into new quadrants when updating quadrants")
+        ("threads", po::value<int>(&threads)->default_value(1), "number of threads")
+        ("task_trace_steps", po::value<int>(&task_trace_steps)->default_value(0), "number of steps whose task timings are written to data/task_trace.txt")
+        ("output_queue_depth", po::value<int>(&output_queue_depth)->default_value(0), "number of frames that can wait for a background thread to write them; 0 writes frames in the step loop")
+        ("domains_x", po::value<int>(&domains_x)->default_value(1), "number of columns of a spatial domain decomposition whose load is printed with progress")
+        ("domains_y", po::value<int>(&domains_y)->default_value(1), "number of rows of a spatial domain decomposition whose load is printed with progress")
+        ("domain_halo", po::value<double>(&domain_halo)->default_value(0.5), "width of the halo of springs each domain needs from its neighbors (um)")
 
         // circular confinement
         ("circle_flag", po::value<bool>(&circle_flag)->default_value(false), "flag to add a circular wall")
@@ -115,6 +142,8 @@ int main(int argc, char **argv)
     double occ;
 
     bool freeze_filaments;
+    bool implicit_stretching_flag;
+    bool rigid_links_flag;
 
     po::options_description config_actin("Filament Options");
     config_actin.add_options()
@@ -147,6 +176,8 @@ int main(int argc, char **argv)
         ("occ", po::value<double>(&occ)->default_value(0), "closest distance crosslinkers and motors can bind on a filament")
 
         ("freeze_filaments", po::value<bool>(&freeze_filaments)->default_value(false), "freeze filaments in place")
+        ("implicit_stretching_flag", po::value<bool>(&implicit_stretching_flag)->default_value(false), "flag to integrate the stretching of filament links implicitly, which allows larger dt for stiff links")
+        ("rigid_links_flag", po::value<bool>(&rigid_links_flag)->default_value(false), "flag to hold filament links at their rest length with constraint forces instead of springs")
         ;
 
     // motors
@@ -316,18 +347,18 @@ int main(int argc, char **argv)
     cmdline_options.add(generic).add(config);
 
     po::variables_map vm;
-    po::store(po::parse_command_line(argc, argv, cmdline_options), vm);
+    po::store(po::command_line_parser(args).options(cmdline_options).run(), vm);
     po::notify(vm);
 
     if (vm.count("help")) {
-        std::cout << generic << "\n";
-        std::cout << config << "\n";
+        out << generic << "\n";
+        out << config << "\n";
         return 1;
     }
 
     ifstream ifs(config_file);
     if (!ifs){
-        cout<<"can not open config file: "<<config_file<<"\n";
+        out<<"can not open config file: "<<config_file<<"\n";
         return 0;
     } else {
         po::store(po::parse_config_file(ifs, config), vm);
@@ -343,6 +374,7 @@ int main(int argc, char **argv)
     string pmfile = tdir + "/pmotors.txt";
     string thfile = ddir + "/filament_e.txt";
     string pefile = ddir + "/pe.txt";
+    string tracefile = ddir + "/task_trace.txt";
 
     if (fs::create_directory(fs::path(dir))) cerr << "Directory Created: " << dir << endl;
     if (fs::create_directory(fs::path(tdir))) cerr << "Directory Created: " << tdir << endl;
@@ -380,6 +412,14 @@ int main(int argc, char **argv)
     int n_bw_print  = max(int((tfinal)/(dt*double(nframes))),1);
     int unprinted_count = int(double(tinit)/dt);
 
+    bool adaptive_dt = (dt_tol > 0);
+    if (dt_min <= 0) dt_min = dt / 100;
+    if (dt_max <= 0) dt_max = 10 * dt;
+    if (adaptive_dt && mts_ratio > 1) {
+        out << "\nadaptive dt (dt_tol > 0) can't be combined with mts_ratio > 1\n";
+        return 1;
+    }
+
     vector<vector<double>> actin_pos_vec;
     vector<vector<double>> a_motor_pos_vec, p_motor_pos_vec;
 
@@ -405,7 +445,7 @@ int main(int argc, char **argv)
         if (restart_time == -1 || restart_time > tf_prev)
             restart_time = tf_prev;
 
-        cout<<"\nRestarting from t = "<<restart_time<<endl;
+        out<<"\nRestarting from t = "<<restart_time<<endl;
 
         double nprinted = restart_time / (dt*n_bw_print);
 
@@ -445,7 +485,7 @@ int main(int argc, char **argv)
     }
 
     double actin_density = double(npolymer*nmonomer)/(xrange*yrange);//0.65;
-    cout<<"\nDEBUG: actin_density = "<<actin_density;
+    out<<"\nDEBUG: actin_density = "<<actin_density;
     double link_bending_stiffness    = polymer_bending_modulus / link_length;
 
     // set number of quadrants to 1 if there are no crosslinkers/motors
@@ -465,6 +505,7 @@ int main(int argc, char **argv)
     box *bc = new box(bnd_cnd, xrange, yrange, restart_strain);
 
     set_seed(myseed);
+    set_num_threads(threads);
 
     // BEGIN GENERATE CONFIGURATIONS
 
@@ -506,7 +547,7 @@ int main(int argc, char **argv)
 
     // BEGIN CREATE NETWORK OBJECTS
 
-    cout<<"\nCreating actin network..";
+    out<<"\nCreating actin network..";
     filament_ensemble *net = new filament_ensemble(
             bc, actin_pos_vec, {xgrid, ygrid}, dt,
             temperature, viscosity, link_length,
@@ -515,9 +556,14 @@ int main(int argc, char **argv)
 
     // additional options
     net->set_growing(kgrow, lgrow, l0min, l0max, nlink_max);
+    if (implicit_stretching_flag) net->set_implicit_stretching(true);
+    if (rigid_links_flag) net->set_rigid_links(true);
+    if (freeze_filaments) net->set_frozen(true);
     if (quad_off_flag) net->get_quads()->use_quad(false);
+    else if (quad_skin > 0) net->set_quad_skin(quad_skin);
+    if (quad_incremental_flag) net->set_quad_incremental(true);
 
-    cout<<"\nAdding active motors...";
+    out<<"\nAdding active motors...";
     motor_ensemble *myosins = new motor_ensemble(
             a_motor_pos_vec, dt, temperature,
             a_motor_length, net, a_motor_v, a_motor_stiffness, a_m_kon, a_m_koff,
@@ -535,7 +581,7 @@ int main(int argc, char **argv)
     if (!std::isnan(a_motor_v2)) myosins->set_velocity(a_motor_v, a_motor_v2);
     if (!std::isnan(a_m_stall2)) myosins->set_stall_force(a_m_stall, a_m_stall2);
 
-    cout<<"Adding passive motors (crosslinkers) ...\n";
+    out<<"Adding passive motors (crosslinkers) ...\n";
     motor_ensemble *crosslks = new motor_ensemble(
             p_motor_pos_vec, dt, temperature,
             p_motor_length, net, p_motor_v, p_motor_stiffness, p_m_kon, p_m_koff,
@@ -584,7 +630,7 @@ int main(int argc, char **argv)
 
     // run simulation
 
-    cout<<"\nUpdating motors, filaments and crosslinks in the network..";
+    out<<"\nUpdating motors, filaments and crosslinks in the network..";
     string time_str;
 
     // open output files
@@ -598,50 +644,201 @@ int main(int argc, char **argv)
     ofstream file_th(thfile, write_mode);
     ofstream file_pe(pefile, write_mode);
 
+    // frames are copied in the step loop, and written by a background thread
+    // when output_queue_depth > 0
+    trajectory_writer writer({&file_a, &file_l, &file_am, &file_pm, &file_th, &file_pe},
+            output_queue_depth);
+
+    // layout of a spatial domain decomposition, only reported
+    domain_grid *domains = nullptr;
+    if (domains_x * domains_y > 1)
+        domains = new domain_grid(bc, domains_x, domains_y, domain_halo);
+
     // set up occ
     size_t n_myosins = myosins->get_nmotors();
     size_t n_crosslks = crosslks->get_nmotors();
-    vector<size_t> motor_ix(n_myosins + n_crosslks);
-    for (size_t i = 0; i < n_myosins + n_crosslks; i++) {
-        motor_ix[i] = i;
-    }
+    vector<size_t> motor_ix;
 
     int count; double t;
-    for (count = 0, t = tinit; t <= tfinal; count++, t += dt) {
 
-        // output to file
-        if (t+dt/100 >= tinit && (count-unprinted_count)%n_bw_print==0) {
+    // multiple time steps
+    // the slow work runs every mts_ratio steps, and right after filaments grow or fracture,
+    // since the held forces belong to the beads before
+    bool slow_step = true;
+    int last_slow_count = -mts_ratio;
+    int slow_interval = 1;
 
-            if (t>tinit) time_str ="\n";
-            time_str += "t = "+to_string(t);
+    // dynamics of a step, as a graph of tasks
+    // tasks that don't depend on each other run at the same time
+    task_graph step;
 
-            fmt::print(file_a, "{}\tN = {}", time_str, net->get_nbeads());
-            net->write_beads(file_a);
+    // Brownian dynamics and motor walking
+    // free heads don't depend on filaments, but bound heads walk on the moved filaments
+    int t_net_integrate = step.add("filament integrate", [&]() {
+        if (!freeze_filaments)
+            net->integrate();
+    });
+    int t_crosslks_free = step.add("crosslinker free heads", [&]() {
+        crosslks->integrate_free();
+    });
+    int t_myosins_free = step.add("myosin free heads", [&]() {
+        myosins->integrate_free();
+    });
+    int t_crosslks_bound = step.add("crosslinker bound heads", [&]() {
+        crosslks->integrate_bound();
+    }, {t_net_integrate, t_crosslks_free});
+    // walking heads of both ensembles update the same filaments
+    int t_myosins_bound = step.add("myosin bound heads", [&]() {
+        myosins->integrate_bound();
+    }, {t_net_integrate, t_myosins_free, t_crosslks_bound});
+
+    // filament growth and fracturing
+    // also unbinds motors
+    int t_montecarlo = step.add("filament montecarlo", [&]() {
+        if (!freeze_filaments)
+            net->montecarlo();
+    }, {t_myosins_bound});
+
+    int t_quads = step.add("quadrants", [&]() {
+        if (mts_ratio > 1) {
+            slow_step = (count - last_slow_count >= mts_ratio) || net->slow_forces_expired();
+            if (!slow_step) return;
+            slow_interval = count - last_slow_count;
+            last_slow_count = count;
+        }
 
-            fmt::print(file_l, "{}\tN = {}", time_str, net->get_nsprings());
-            net->write_springs(file_l);
+        if (freeze_filaments) {
+            // built once, and again only after shear
+            net->quad_update_frozen(quad_off_flag);
 
-            fmt::print(file_am, "{}\tN = {}", time_str, myosins->get_nmotors());
-            myosins->motor_write(file_am);
+        } else if (quad_off_flag) {
+            // we want results that are correct regardless of other settings when quadrants are off
+            // this just builds a list of all springs, which are then handed to attachment/etc
+            net->quad_update_serial();
 
-            fmt::print(file_pm, "{}\tN = {}", time_str, crosslks->get_nmotors());
-            crosslks->motor_write(file_pm);
+        } else if (quad_skin > 0) {
+            // rebuilds only when the springs may have moved past the skin
+            net->quad_update_verlet();
 
-            fmt::print(file_th, "{}\tN = {}", time_str, net->get_nfilaments());
-            net->write_thermo(file_th);
+        } else if (count % quad_update_period == 0) {
+            // when quadrants are on, this actually builds quadrants
+            net->quad_update();
 
-            fmt::print(file_pe,
-                    "{}\t{}\t{}\t{}\t"
+        }
+    }, {t_montecarlo});
+
+    // motor attachment/detachment
+    int t_attach = step.add("attach/detach", [&]() {
+        if (!slow_step) return;
+        if (mts_ratio > 1) {
+            // binding probabilities cover the steps since the last attempt
+            myosins->set_binding_interval(slow_interval * dt);
+            crosslks->set_binding_interval(slow_interval * dt);
+        }
 
-                    "{}\t{}\t{}\t{}\t"
-                    "{}\t{}\t{}\t{}\t"
-                    "{}\t{}\t{}\t{}\t"
+        if (occ > 0.0) {
+            // occlusion depends on the order of moves,
+            // so moves are proposed in parallel and committed in random order
+            myosins->propose_attach_detach();
+            crosslks->propose_attach_detach();
+            motor_ix.clear();
+            for (size_t i = 0; i < n_myosins; i++) {
+                if (myosins->has_move(i)) motor_ix.push_back(i);
+            }
+            for (size_t i = 0; i < n_crosslks; i++) {
+                if (crosslks->has_move(i)) motor_ix.push_back(i + n_myosins);
+            }
+            rng_shuffle(motor_ix, 0);
+            for (size_t i : motor_ix) {
+                if (i < n_myosins) {
+                    myosins->commit_attach_detach(i);
+                } else {
+                    crosslks->commit_attach_detach(i - n_myosins);
+                }
+            }
+        } else {
+            crosslks->try_attach_detach();
+            myosins->try_attach_detach();
+        }
+    }, {t_quads});
+
+    // compute forces and energies
+    // filament forces don't depend on motors,
+    // and motor forces are added to filaments after them, in a fixed order
+    int t_net_forces = step.add("filament forces", [&]() {
+        if (freeze_filaments) return;
+        if (mts_ratio > 1) {
+            if (slow_step) net->compute_slow_forces();
+            net->compute_fast_forces();
+            net->add_slow_forces();
+        } else {
+            net->compute_forces();
+        }
+    }, {t_quads});
+    int t_crosslks_forces = step.add("crosslinker forces", [&]() {
+        crosslks->update_head_forces();
+    }, {t_attach});
+    int t_myosins_forces = step.add("myosin forces", [&]() {
+        myosins->update_head_forces();
+    }, {t_attach});
+    int t_crosslks_gather = step.add("crosslinker gather", [&]() {
+        crosslks->gather_forces();
+    }, {t_net_forces, t_crosslks_forces});
+    step.add("myosin gather", [&]() {
+        myosins->gather_forces();
+    }, {t_crosslks_gather, t_myosins_forces});
+
+    ofstream file_trace;
+    if (task_trace_steps > 0) {
+        file_trace.open(tracefile);
+        step.set_trace(&file_trace, task_trace_steps);
+    }
+
+    // adaptive steps
+    // frames are written at the times they would be with a fixed dt,
+    // and steps are cut short to end on them
+    step_control *control = nullptr;
+    double frame_interval = dt * n_bw_print;
+    long rng_step0 = llround(tinit / dt);
+    long nframes_done = 0;
+    double t_end = tfinal;
+    if (adaptive_dt) {
+        control = new step_control(dt, dt_min, dt_max, dt_tol);
+        t_end += 1e-9 * frame_interval;
+    }
+
+    for (count = 0, t = tinit; t <= t_end; count++, t += dt) {
 
-                    "{}\t{}\t{}\t{}\t"
-                    "{}\t{}\t{}\t{}\t"
-                    "{}\t{}\t{}\t{}\n",
+        // random streams are keyed by the step, so restarts continue them
+        // (adaptive runs restart from the first dt)
+        set_rng_step(adaptive_dt ? rng_step0 + count : llround(t / dt));
 
-                    t, bc->get_xbox(), bc->get_ybox(), bc->get_delrx(),
+        // output to file
+        bool print_frame;
+        double t_frame = t;
+        if (adaptive_dt) {
+            t_frame = tinit + nframes_done * frame_interval;
+            print_frame = (t >= t_frame - 1e-9 * frame_interval);
+            if (print_frame) nframes_done++;
+        } else {
+            print_frame = (t+dt/100 >= tinit && (count-unprinted_count)%n_bw_print==0);
+        }
+        if (print_frame) {
+
+            if (t_frame>tinit) time_str ="\n";
+            time_str += "t = "+to_string(t_frame);
+
+            frame_type &frame = writer.next();
+            frame.time_str = time_str;
+            net->copy_beads(frame.beads);
+            net->copy_springs(frame.springs);
+            myosins->copy_output(frame.myosins);
+            crosslks->copy_output(frame.crosslks);
+            net->copy_thermo(frame.thermo);
+
+            frame.pe.clear();
+            frame.pe.insert(frame.pe.end(), {
+                    t_frame, bc->get_xbox(), bc->get_ybox(), bc->get_delrx(),
 
                     net->get_stretching_energy(),
                     net->get_bending_energy(),
@@ -656,8 +853,8 @@ int main(int argc, char **argv)
                     crosslks->get_stretching_energy(),
                     crosslks->get_bending_energy(),
                     crosslks->get_alignment_energy(),
-                    crosslks->get_external_energy(),
-
+                    crosslks->get_external_energy()});
+            for (virial_type v : {
                     net->get_stretching_virial(),
                     net->get_bending_virial(),
                     net->get_excluded_virial(),
@@ -671,23 +868,35 @@ int main(int argc, char **argv)
                     crosslks->get_stretching_virial(),
                     crosslks->get_bending_virial(),
                     crosslks->get_alignment_virial(),
-                    crosslks->get_external_virial());
-
-            file_a<<std::flush;
-            file_l<<std::flush;
-            file_am<<std::flush;
-            file_pm<<std::flush;
-            file_th<<std::flush;
-            file_pe<<std::flush;
+                    crosslks->get_external_virial()}) {
+                frame.pe.insert(frame.pe.end(), {v.xx, v.xy, v.yx, v.yy});
+            }
+
+            writer.push();
         }
 
         // print to stdout
         if (count%n_bw_stdout==0) {
-            fmt::print("\nCount: {}\tTime: {} s\tShear: {} um", count, t, bc->get_delrx());
+            fmt::print(out, "\nCount: {}\tTime: {} s\tShear: {} um", count, t, bc->get_delrx());
             //net->print_filament_thermo();
-            net->print_network_thermo();
-            crosslks->print_ensemble_thermo();
-            myosins->print_ensemble_thermo();
+            net->print_network_thermo(out);
+            if (rigid_links_flag) fmt::print(out, "\tlinks off length = {}", net->get_constraint_misses());
+            crosslks->print_ensemble_thermo(out);
+            myosins->print_ensemble_thermo(out);
+            if (domains) domains->print_census(out, net, {myosins, crosslks});
+            if (adaptive_dt) fmt::print(out, "\ndt = {} s", dt);
+        }
+
+        // size the step from the forces at its start
+        if (adaptive_dt) {
+            double drift = max(myosins->get_max_drift(), crosslks->get_max_drift());
+            if (!freeze_filaments) drift = max(drift, net->get_max_drift());
+            double rate = max(myosins->get_max_rate(), crosslks->get_max_rate());
+            double t_next = tinit + nframes_done * frame_interval;
+            dt = control->next(drift, rate, t_next - t);
+            net->set_dt(dt);
+            myosins->set_dt(dt);
+            crosslks->set_dt(dt);
         }
 
         // shear
@@ -727,67 +936,195 @@ int main(int argc, char **argv)
             bc->update_d_strain(d_strain - bc->get_delrx());
         }
 
-        // Brownian dynamics and motor walking
-        if (!freeze_filaments)
-            net->integrate();
-        crosslks->integrate();
-        myosins->integrate();
-
-        // filament growth and fracturing
-        // also unbinds motors
-        if (!freeze_filaments)
-            net->montecarlo();
-
-        if (quad_off_flag) {
-            // we want results that are correct regardless of other settings when quadrants are off
-            // this just builds a list of all springs, which are then handed to attachment/etc
-            net->quad_update_serial();
-
-        } else if (count % quad_update_period == 0) {
-            // when quadrants are on, this actually builds quadrants
-            net->quad_update_serial();
-
-        }
-
-        // motor attachment/detachment
-        if (occ > 0.0) {
-            std::shuffle(motor_ix.begin(), motor_ix.end(), get_rng());
-            for (size_t i : motor_ix) {
-                if (i < n_myosins) {
-                    myosins->try_attach_detach(i);
-                } else {
-                    crosslks->try_attach_detach(i - n_myosins);
-                }
-            }
-        } else {
-            crosslks->try_attach_detach();
-            myosins->try_attach_detach();
-        }
-
-        // compute forces and energies
-        if (!freeze_filaments)
-            net->compute_forces();
-        crosslks->compute_forces();
-        myosins->compute_forces();
+        step.run();
     }
 
+    writer.finish();
     file_a << "\n";
     file_l << "\n";
     file_am << "\n";
     file_pm << "\n";
     file_th << "\n";
 
+    out<<"\nQuadrant rebuilds: "<<net->get_quad_rebuilds();
+    out<<"\n";
+    print_load_balance(out);
+    step.print_summary(out);
+    writer.print_summary(out);
+    if (control) control->print_summary(out);
+
     //Delete all objects created
-    cout<<"\nHere's where I think I delete things\n";
+    out<<"\nHere's where I think I delete things\n";
 
+    delete control;
+    delete domains;
     delete myosins;
     delete crosslks;
     delete net;
     delete bc;
 
-    cout<<"\nTime counts: "<<count;
-    cout<<"\nExecuted";
-    cout<<"\n Done\n";
+    out<<"\nTime counts: "<<count;
+    out<<"\nExecuted";
+    out<<"\n Done\n";
 
+    nsteps = count;
     return 0;
 }
+
+// parameters of a sweep, one per line: name=value1,value2,...
+// blank lines and lines starting with # are skipped
+static vector<pair<string, vector<string>>> read_sweep(string file)
+{
+    ifstream ifs(file);
+    if (!ifs) throw runtime_error("can not open sweep file: " + file);
+
+    vector<pair<string, vector<string>>> params;
+    string line;
+    while (getline(ifs, line)) {
+        boost::trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        size_t eq = line.find('=');
+        if (eq == string::npos) throw runtime_error("sweep line without '=': " + line);
+        string name = boost::trim_copy(line.substr(0, eq));
+        string list = line.substr(eq + 1);
+        vector<string> values;
+        boost::split(values, list, boost::is_any_of(","));
+        for (string &v : values) boost::trim(v);
+        params.push_back({name, values});
+    }
+    return params;
+}
+
+// runs a replica of the simulation for every combination of the swept parameters,
+// threads replicas at a time, each on a single thread with its own random state
+static int run_sweep(const vector<string> &args, string sweep_file, string dir, int threads)
+{
+    vector<pair<string, vector<string>>> params = read_sweep(sweep_file);
+
+    // the first parameter varies slowest
+    vector<vector<string>> points = {{}};
+    for (auto &param : params) {
+        vector<vector<string>> next;
+        for (vector<string> &point : points) {
+            for (string &v : param.second) {
+                next.push_back(point);
+                next.back().push_back(v);
+            }
+        }
+        points = next;
+    }
+    int nreplicas = points.size();
+
+    fs::create_directories(fs::path(dir));
+    {
+        ofstream index(dir + "/replicas.txt");
+        index << "replica";
+        for (auto &param : params) index << "\t" << param.first;
+        index << "\n";
+        for (int k = 0; k < nreplicas; k++) {
+            index << k;
+            for (string &v : points[k]) index << "\t" << v;
+            index << "\n";
+        }
+    }
+
+    vector<long> nsteps(nreplicas, 0);
+    vector<double> times(nreplicas, 0.0);
+    vector<string> errors(nreplicas);
+    std::atomic<int> next_replica(0);
+    std::mutex print_lock;
+
+    auto worker = [&]() {
+        rng_state rng;
+        bind_rng_state(&rng);
+        set_num_threads(1);
+        for (int k = next_replica++; k < nreplicas; k = next_replica++) {
+            string rdir = dir + "/replica_" + to_string(k);
+            vector<string> rargs = args;
+            rargs.insert(rargs.end(), {"--dir", rdir, "--threads", "1"});
+            for (size_t p = 0; p < params.size(); p++)
+                rargs.insert(rargs.end(), {"--" + params[p].first, points[k][p]});
+
+            double start = wall_time();
+            try {
+                fs::create_directory(fs::path(rdir));
+                ofstream log(rdir + "/log.txt");
+                rng = rng_state();
+                if (run_simulation(rargs, log, nsteps[k]) != 0)
+                    errors[k] = "see " + rdir + "/log.txt";
+            } catch (exception &e) {
+                errors[k] = e.what();
+            }
+            times[k] = wall_time() - start;
+
+            std::lock_guard<std::mutex> guard(print_lock);
+            if (errors[k].empty())
+                fmt::print("\nreplica {}: {} steps in {:.2f} s", k, nsteps[k], times[k]);
+            else
+                fmt::print("\nreplica {}: failed: {}", k, errors[k]);
+            cout << flush;
+        }
+        bind_rng_state(nullptr);
+    };
+
+    double start = wall_time();
+    vector<std::thread> pool;
+    for (int i = 0; i < min(threads, nreplicas); i++)
+        pool.emplace_back(worker);
+    for (std::thread &t : pool)
+        t.join();
+    double wall = wall_time() - start;
+
+    long total_steps = 0;
+    double busy = 0.0;
+    int nfailed = 0;
+    for (int k = 0; k < nreplicas; k++) {
+        total_steps += nsteps[k];
+        busy += times[k];
+        if (!errors[k].empty()) nfailed++;
+    }
+    fmt::print("\nSweep: {} replicas ({} failed) on {} threads in {:.2f} s\n", nreplicas, nfailed, pool.size(), wall);
+    fmt::print("  {:.1f} steps/s in total, {:.0f}% of the threads busy\n",
+            total_steps / wall, 100.0 * busy / (wall * max<size_t>(pool.size(), 1)));
+
+    return nfailed > 0 ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    vector<string> args(argv + 1, argv + argc);
+
+    // only a sweep needs these before the simulation parses all options
+    string config_file, sweep_file, dir;
+    int threads;
+    po::options_description sweep_options;
+    sweep_options.add_options()
+        ("config,c", po::value<string>(&config_file)->default_value("config/network.cfg"), "")
+        ("sweep", po::value<string>(&sweep_file)->default_value(""), "")
+        ("dir", po::value<string>(&dir)->default_value("."), "")
+        ("threads", po::value<int>(&threads)->default_value(1), "")
+        ;
+
+    po::variables_map vm;
+    po::parsed_options parsed = po::command_line_parser(args).options(sweep_options)
+        .style(po::command_line_style::default_style & ~po::command_line_style::allow_guessing)
+        .allow_unregistered().run();
+    po::store(parsed, vm);
+    po::notify(vm);
+
+    if (sweep_file.empty()) {
+        long nsteps;
+        return run_simulation(args, cout, nsteps);
+    }
+
+    ifstream ifs(config_file);
+    if (ifs) {
+        po::store(po::parse_config_file(ifs, sweep_options, true), vm);
+        po::notify(vm);
+    }
+
+    // replicas get their own dir and threads
+    vector<string> rargs = po::collect_unrecognized(parsed.options, po::include_positional);
+    rargs.insert(rargs.end(), {"--config", config_file});
+    return run_sweep(rargs, sweep_file, dir, max(threads, 1));
+}
@@ -0,0 +1,133 @@
+"""
+Compare the stress and bead mean squared displacement of AFINES runs.
+
+Used to validate integrator settings, such as ``mts_ratio``, against a
+reference run of the same system: run the reference and the candidate with
+the same configuration for about the same wall time, then
+
+    python compare_runs.py reference_dir candidate_dir ...
+
+The first directory is the reference. Stresses are averaged over the frames
+after ``--tmin``, and the MSD is compared at the lags that all runs share.
+
+"""
+
+import argparse
+
+import numpy as np
+
+import output
+
+
+def stress(pe):
+    """
+    Stress tensor of each frame, from the total virial.
+
+    Parameters
+    ----------
+    pe : (N,) ndarray of output.pe_dtype
+        Box parameters, potential energies, and virials at each frame.
+
+    Returns
+    -------
+    sigma : (N, 2, 2) ndarray of float
+        Minus the total virial per area.
+
+    """
+    sigma = np.zeros((len(pe), 2, 2))
+    for name, _ in output.pe_dtype:
+        if "_virial_" not in name:
+            continue
+        i = "xy".index(name[-2])
+        j = "xy".index(name[-1])
+        sigma[:, i, j] -= pe[name]
+    return sigma / (pe["xbox"] * pe["ybox"])[:, None, None]
+
+
+def msd(times, actins, xbox, ybox):
+    """
+    Mean squared displacement of beads against lag time.
+
+    Positions are unwrapped with the minimum image between frames,
+    so beads must move less than half the box between frames.
+    Lees-Edwards shear is not removed.
+
+    Parameters
+    ----------
+    times : (N,) ndarray of float
+        Time of each frame.
+    actins : (N, M) ndarray of output.actins_dtype
+        Beads at each frame, with the same M beads in every frame.
+    xbox, ybox : float
+        Box size.
+
+    Returns
+    -------
+    lags : (N - 1,) ndarray of float
+        Lag times.
+    msd : (N - 1,) ndarray of float
+        Mean squared displacement at each lag.
+
+    """
+    pos = np.stack([actins["x"], actins["y"]], axis=-1)
+    step = np.diff(pos, axis=0)
+    box = np.array([xbox, ybox])
+    step -= box * np.round(step / box)
+    path = np.concatenate([np.zeros((1,) + pos.shape[1:]), np.cumsum(step, axis=0)])
+
+    lags = times[1:] - times[0]
+    result = np.array(
+        [np.mean(np.sum((path[k:] - path[:-k]) ** 2, axis=-1)) for k in range(1, len(times))]
+    )
+    return lags, result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dirs", nargs="+", help="AFINES output directories, the reference first")
+    parser.add_argument("--tmin", type=float, default=0.0, help="start of the averages (s)")
+    args = parser.parse_args()
+
+    curves = []
+    for dirname in args.dirs:
+        pe = output.load_pe(dirname)
+        sigma = stress(pe[pe["time"] >= args.tmin])
+        mean = sigma.mean(axis=0)
+        err = sigma.std(axis=0) / np.sqrt(max(len(sigma) - 1, 1))
+        print(dirname)
+        print(
+            "  stress xx {:.4g} +- {:.2g}  yy {:.4g} +- {:.2g}  xy {:.4g} +- {:.2g}".format(
+                mean[0, 0], err[0, 0], mean[1, 1], err[1, 1], mean[0, 1], err[0, 1]
+            )
+        )
+
+        try:
+            times, actins = output.load_actins(dirname)
+        except ValueError:
+            actins = None
+        if actins is None or actins.dtype == object:
+            print("  msd: the number of beads changes, skipped")
+            curves.append(None)
+            continue
+        curves.append(msd(times, actins, pe["xbox"][0], pe["ybox"][0]))
+
+    if curves[0] is None:
+        return
+    lags, ref = curves[0]
+    for dirname, curve in zip(args.dirs[1:], curves[1:]):
+        if curve is None:
+            continue
+        n = min(len(lags), len(curve[0]))
+        if n == 0 or not np.allclose(lags[:n], curve[0][:n]):
+            print("{}: msd at different lags than the reference, skipped".format(dirname))
+            continue
+        rel = curve[1][:n] / ref[:n] - 1.0
+        print(
+            "{}: msd relative to reference: mean {:+.3f}, max |{:.3f}| over {} lags".format(
+                dirname, rel.mean(), np.abs(rel).max(), n
+            )
+        )
+
+
+if __name__ == "__main__":
+    main()
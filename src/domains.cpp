@@ -0,0 +1,123 @@
+#include "domains.h"
+#include "filament_ensemble.h"
+#include "motor_ensemble.h"
+
+domain_grid::domain_grid(box *bc, int nx, int ny, double halo)
+{
+    if (nx < 1 || ny < 1) throw runtime_error("a domain grid needs at least one domain in each direction");
+    this->bc = bc;
+    this->nx = nx;
+    this->ny = ny;
+    this->halo = halo;
+}
+
+int domain_grid::get_ndomains()
+{
+    return nx * ny;
+}
+
+int domain_grid::owner(vec_type pos)
+{
+    vec_type p = bc->pos_bc(pos);
+    double xbox = bc->get_xbox();
+    double ybox = bc->get_ybox();
+    int col = int(floor((p.x + 0.5 * xbox) * nx / xbox));
+    int row = int(floor((p.y + 0.5 * ybox) * ny / ybox));
+    return max(0, min(row, ny - 1)) * nx + max(0, min(col, nx - 1));
+}
+
+void domain_grid::add_overlapping(vec_type lo, vec_type hi, vector<int> &out)
+{
+    double xbox = bc->get_xbox();
+    double ybox = bc->get_ybox();
+    if (hi.x < -0.5 * xbox || lo.x > 0.5 * xbox || hi.y < -0.5 * ybox || lo.y > 0.5 * ybox) return;
+
+    int col0 = max(0, int(floor((lo.x + 0.5 * xbox) * nx / xbox)));
+    int col1 = min(nx - 1, int(floor((hi.x + 0.5 * xbox) * nx / xbox)));
+    int row0 = max(0, int(floor((lo.y + 0.5 * ybox) * ny / ybox)));
+    int row1 = min(ny - 1, int(floor((hi.y + 0.5 * ybox) * ny / ybox)));
+    for (int row = row0; row <= row1; row++) {
+        for (int col = col0; col <= col1; col++) {
+            out.push_back(row * nx + col);
+        }
+    }
+}
+
+void domain_grid::overlapping(vec_type lo, vec_type hi, vector<int> &out)
+{
+    out.clear();
+    bc_type BC = bc->get_BC();
+    double xbox = bc->get_xbox();
+    double ybox = bc->get_ybox();
+    bool xper = (BC != bc_type::nonperiodic);
+    bool yper = (BC == bc_type::periodic || BC == bc_type::lees_edwards);
+
+    // the image one box up is shifted by delrx with Lees-Edwards boundaries,
+    // see box::rij_bc
+    for (int iy = (yper ? -1 : 0); iy <= (yper ? 1 : 0); iy++) {
+        double shift = (BC == bc_type::lees_edwards) ? iy * bc->get_delrx() : 0.0;
+        if (xper) shift -= xbox * floor(shift / xbox + 0.5);
+        for (int ix = (xper ? -2 : 0); ix <= (xper ? 2 : 0); ix++) {
+            vec_type image = {shift + ix * xbox, iy * ybox};
+            this->add_overlapping(lo + image, hi + image, out);
+        }
+    }
+
+    sort(out.begin(), out.end());
+    out.erase(unique(out.begin(), out.end()), out.end());
+}
+
+void domain_grid::neighbors(int d, vector<int> &out)
+{
+    double w = bc->get_xbox() / nx;
+    double h = bc->get_ybox() / ny;
+    vec_type lo = {-0.5 * bc->get_xbox() + (d % nx) * w - halo, -0.5 * bc->get_ybox() + (d / nx) * h - halo};
+    vec_type hi = {lo.x + w + 2 * halo, lo.y + h + 2 * halo};
+    this->overlapping(lo, hi, out);
+    out.erase(remove(out.begin(), out.end(), d), out.end());
+}
+
+void domain_grid::halo_domains(vec_type r, vec_type disp, vector<int> &out)
+{
+    vec_type p = bc->pos_bc(r);
+    vec_type q = p + disp;
+    vec_type lo = {min(p.x, q.x) - halo, min(p.y, q.y) - halo};
+    vec_type hi = {max(p.x, q.x) + halo, max(p.y, q.y) + halo};
+    this->overlapping(lo, hi, out);
+    out.erase(remove(out.begin(), out.end(), this->owner(p)), out.end());
+}
+
+void domain_grid::print_census(ostream &out, filament_ensemble *net, vector<motor_ensemble *> motors)
+{
+    int n = nx * ny;
+    vector<long> beads(n, 0), springs(n, 0), nmotors(n, 0);
+    vec_type *pos = net->get_positions();
+    vec_type *disp = net->get_spring_disps();
+    vector<int> ds;
+
+    for (filament *f : *net->get_network()) {
+        int first = f->get_offset();
+        int last = first + f->get_nbeads();
+        for (int i = first; i < last; i++) {
+            beads[this->owner(pos[i])]++;
+        }
+        for (int i = first; i < last - 1; i++) {
+            this->halo_domains(pos[i], disp[i], ds);
+            for (int d : ds) springs[d]++;
+        }
+    }
+    for (motor_ensemble *m : motors) {
+        for (int i = 0; i < m->get_nmotors(); i++) {
+            nmotors[this->owner(m->get_h0(i))]++;
+        }
+    }
+
+    auto summary = [n](const vector<long> &v) {
+        long tot = 0;
+        for (long x : v) tot += x;
+        return fmt::format("max {} mean {:.1f}", *max_element(v.begin(), v.end()), double(tot) / n);
+    };
+    this->neighbors(0, ds);
+    fmt::print(out, "\nDomains {}x{}\tbeads {}\tmotors {}\thalo springs {}\tneighbors of domain 0: {}",
+            nx, ny, summary(beads), summary(nmotors), summary(springs), ds.size());
+}
@@ -1,26 +1,58 @@
 #include "exv.h"
+#include "filament_ensemble.h"
+#include "scheduler.h"
 
-void excluded_volume::update_spring_forces_from_quads(quadrants *quads, vector<filament *> &network)
+// contacts are found in parallel over blocks of pairs,
+// then applied on one thread in pair order,
+// so forces and energies don't depend on the number of threads
+void excluded_volume::update_spring_forces_from_quads(quadrants *quads, filament_ensemble *net)
 {
     pe_exv = 0.0;
     vir_exv.zero();
 
-    for (array<array<int, 2>, 2> pair : *quads->get_pairs()) {
-        int f1 = pair[0][0];
-        int l1 = pair[0][1];
-        int f2 = pair[1][0];
-        int l2 = pair[1][1];
-
-        // adjacent springs would yield excluded volume interactions between the same bead
-        if (f1 == f2 && abs(l1 - l2) < 2) continue;
+    vector<filament *> &network = *net->get_network();
+    vector<array<array<int, 2>, 2>> &pairs = *quads->get_pairs();
+
+    int nblocks = get_nblocks();
+    contact_blocks.resize(nblocks);
+    vector<char> intersect(nblocks, 0);
+
+    balanced_for(load_exv, pairs.size(), nullptr, [&](int blk, int first, int last) {
+        vector<exv_contact> &out = contact_blocks[blk];
+        out.clear();
+        for (int p = first; p < last; p++) {
+            int f1 = pairs[p][0][0];
+            int l1 = pairs[p][0][1];
+            int f2 = pairs[p][1][0];
+            int l2 = pairs[p][1][1];
+
+            // adjacent springs would yield excluded volume interactions between the same bead
+            if (f1 == f2 && abs(l1 - l2) < 2) continue;
+
+            int s1 = network[f1]->get_offset() + l1;
+            int s2 = network[f2]->get_offset() + l2;
+            exv_contact c;
+            try {
+                if (this->find_contact(net, s1, s2, c)) out.push_back(c);
+            } catch (runtime_error &) {
+                // exceptions can't leave a parallel region
+                intersect[blk] = 1;
+                break;
+            }
+        }
+    });
 
-        update_force_between_filaments(network, f1, l2, f2, l2);
+    for (int blk = 0; blk < nblocks; blk++) {
+        if (intersect[blk]) throw runtime_error("Intersecting filaments with excluded volume!");
+        for (const exv_contact &c : contact_blocks[blk])
+            this->apply_contact(net, c);
     }
 }
 
-void excluded_volume::update_spring_forces(vector<filament *> &network, int f)
+void excluded_volume::update_spring_forces(filament_ensemble *net, int f)
 {
     //This function loops through every filament and spring in the network and applies the force calulation under certain limits
+    vector<filament *> &network = *net->get_network();
     int net_sz = network.size();
 
     // for every spring in filament f
@@ -32,38 +64,45 @@ void excluded_volume::update_spring_forces(vector<filament *> &network, int f)
             int oth_lks_sz = network[g]->get_nsprings();
             for (int j = 0; j < oth_lks_sz; j++) {
 
-                update_force_between_filaments(network, f, i, g, j);
+                update_force_between_filaments(
+                        net, network[f]->get_offset() + i, network[g]->get_offset() + j);
             }
         }
     }
 }
 
-void excluded_volume::update_force_between_filaments(
-        vector<filament *> &network, int n1, int l1, int n2, int l2)
+void excluded_volume::update_force_between_filaments(filament_ensemble *net, int s1, int s2)
+{
+    exv_contact c;
+    if (this->find_contact(net, s1, s2, c)) this->apply_contact(net, c);
+}
+
+bool excluded_volume::find_contact(filament_ensemble *net, int s1, int s2, exv_contact &c)
 {
     //This function calculates the forces applied to the actin beads of a pair of filaments under certain limits.
     //Here, we use distance of closest approach to describe the direction and magnitude of the forces.
 
     double b = 1/rmax;
 
-    spring *s1 = network[n1]->get_spring(l1);
-    spring *s2 = network[n2]->get_spring(l2);
+    // spring s connects beads s and s + 1
+    vec_type *pos = net->get_positions();
+    double *llen = net->get_spring_lengths();
 
-    vec_type h0_1 = s1->get_h0();
-    vec_type h1_1 = s1->get_h1();
+    vec_type h0_1 = pos[s1];
+    vec_type h1_1 = pos[s1 + 1];
 
-    vec_type h0_2 = s2->get_h0();
-    vec_type h1_2 = s2->get_h1();
+    vec_type h0_2 = pos[s2];
+    vec_type h1_2 = pos[s2 + 1];
 
     array<double, 2> len;
-    len[0] = s1->get_length();
-    len[1] = s2->get_length();
+    len[0] = llen[s1];
+    len[1] = llen[s2];
 
     // compute the nearest point on the other spring
-    vec_type p1 = s1->intpoint(h0_2);
-    vec_type p2 = s1->intpoint(h1_2);
-    vec_type p3 = s2->intpoint(h0_1);
-    vec_type p4 = s2->intpoint(h1_1);
+    vec_type p1 = net->intpoint(s1, h0_2);
+    vec_type p2 = net->intpoint(s1, h1_2);
+    vec_type p3 = net->intpoint(s2, h0_1);
+    vec_type p4 = net->intpoint(s2, h1_1);
 
     // compute the distance to the nearest point
     array<double, 4> r_c;
@@ -83,71 +122,70 @@ void excluded_volume::update_force_between_filaments(
         }
     }
 
-    bool intersect = s1->get_line_intersect(s2);
-
-    if (r < rmax) {
-
-        if (intersect) throw runtime_error("Intersecting filaments with excluded volume!");
-
-        double length = 0.0;
-        double len1 = 0.0;
-        vec_type dist;
-        if (index == 0) {
-            r = r_c[0];
-            len1 = bc->dist_bc(h0_1 - p1);
-            length = len[0];
-            dist = bc->rij_bc(p1 - h0_2);
-        } else if (index == 1) {
-            r = r_c[1];
-            len1 = bc->dist_bc(h0_1 - p2);
-            length = len[0];
-            dist = bc->rij_bc(p2 - h1_2);
-        } else if (index == 2) {
-            r = r_c[2];
-            len1 = bc->dist_bc(h0_2 - p3);
-            length = len[1];
-            dist = bc->rij_bc(p3 - h0_1);
-        } else if (index == 3) {
-            r = r_c[3];
-            len1 = bc->dist_bc(h0_2 - p4);
-            length = len[1];
-            dist = bc->rij_bc(p4 - h1_1);
-        }
+    if (r >= rmax) return false;
+
+    if (net->line_intersect(s1, s2)) throw runtime_error("Intersecting filaments with excluded volume!");
+
+    double length = 0.0;
+    double len1 = 0.0;
+    vec_type dist;
+    if (index == 0) {
+        r = r_c[0];
+        len1 = bc->dist_bc(h0_1 - p1);
+        length = len[0];
+        dist = bc->rij_bc(p1 - h0_2);
+        c.s = s1;
+        c.b = s2;
+    } else if (index == 1) {
+        r = r_c[1];
+        len1 = bc->dist_bc(h0_1 - p2);
+        length = len[0];
+        dist = bc->rij_bc(p2 - h1_2);
+        c.s = s1;
+        c.b = s2 + 1;
+    } else if (index == 2) {
+        r = r_c[2];
+        len1 = bc->dist_bc(h0_2 - p3);
+        length = len[1];
+        dist = bc->rij_bc(p3 - h0_1);
+        c.s = s2;
+        c.b = s1;
+    } else {
+        r = r_c[3];
+        len1 = bc->dist_bc(h0_2 - p4);
+        length = len[1];
+        dist = bc->rij_bc(p4 - h1_1);
+        c.s = s2;
+        c.b = s1 + 1;
+    }
 
-        double len2 = length - len1;
-        double r_1 = len2/length;
-        double r_2 = len1/length;
-
-        vec_type F = 2*kexv*dist*b*((1/r) - b);
-
-        pe_exv += kexv*pow((1-r*b),2);
-        vir_exv += -0.5 * outer(dist, F);
-
-        if (index == 0) {
-            network[n1]->update_forces(l1, F*r_1);
-            network[n1]->update_forces(l1+1, F*r_2);
-            network[n2]->update_forces(l2, -F);
-        } else if (index == 1) {
-            network[n1]->update_forces(l1, F*r_1);
-            network[n1]->update_forces(l1+1, F*r_2);
-            network[n2]->update_forces(l2+1, -F);
-        } else if (index == 2) {
-            network[n2]->update_forces(l2, F*r_1);
-            network[n2]->update_forces(l2+1, F*r_2);
-            network[n1]->update_forces(l1, -F);
-        } else if (index == 3) {
-            network[n2]->update_forces(l2, F*r_1);
-            network[n2]->update_forces(l2+1, F*r_2);
-            network[n1]->update_forces(l1+1, -F);
-        }
+    double len2 = length - len1;
+    c.r = r;
+    c.r_1 = len2/length;
+    c.r_2 = len1/length;
+    c.dist = dist;
+    c.F = 2*kexv*dist*b*((1/r) - b);
+    return true;
+}
 
-    }
+void excluded_volume::apply_contact(filament_ensemble *net, const exv_contact &c)
+{
+    double b = 1/rmax;
+    vec_type *force = net->get_forces();
+
+    pe_exv += kexv*pow((1-c.r*b),2);
+    vir_exv += -0.5 * outer(c.dist, c.F);
+
+    force[c.s] += c.F*c.r_1;
+    force[c.s+1] += c.F*c.r_2;
+    force[c.b] -= c.F;
 }
 
-void excluded_volume::update_excluded_volume(vector<filament *> &network, int f)
+void excluded_volume::update_excluded_volume(filament_ensemble *net, int f)
 {
     //For every filament bead on f, for every bead not on f, calculate the force between the two bead using the Jones potential, and update them ( maybe divide by half due to overcaluclations).
 
+    vector<filament *> &network = *net->get_network();
     int net_sz = network.size();
     //10^6 included to account for m to microm conversion
     double a = 0.004;
@@ -13,8 +13,8 @@
 
 #include "filament.h"
 #include "filament_ensemble.h"
-#include "bead.h"
 #include "globals.h"
+#include "motor_ensemble.h"
 #include "potentials.h"
 
 filament::filament(filament_ensemble *net, vector<vector<double>> beadvec, double spring_length,
@@ -28,7 +28,11 @@ filament::filament(filament_ensemble *net, vector<vector<double>> beadvec, doubl
     temperature = temp;
     fracture_force = frac_force;
     fracture_force_sq = fracture_force*fracture_force;
+    kl = stretching_stiffness;
     kb = bending_stiffness;
+    implicit_stretching = false;
+    rigid_links = false;
+    constraint_misses = 0;
 
     ubend = 0.0;
 
@@ -40,88 +44,402 @@ filament::filament(filament_ensemble *net, vector<vector<double>> beadvec, doubl
     kgrow = 0.0;
     lgrow = 0.0;
 
+    occupancy_dirty = false;
+
+    nbeads = 0;
+    capacity = beadvec.size();
+    offset = net->allocate_beads(capacity);
+
+    rad = 0.0;
+    visc = 0.0;
     damp = infty;
-    if (beadvec.size() > 0)
-    {
-        vector<double> &entry = beadvec[0];
-        if (entry.size() != 4) throw runtime_error("Wrong number of arguments in beadvec.");
-        beads.push_back(new bead(entry[0], entry[1], entry[2], entry[3]));
-        prv_rnds.push_back(vec_randn());
-        damp = beads[0]->get_friction();
-    }
+
+    vec_type *pos = net->get_positions() + offset;
+    vec_type *force = net->get_forces() + offset;
+    vec_type *prv_rnd = net->get_prv_rnds() + offset;
+    double *l0 = net->get_spring_l0s() + offset;
 
     //spring em up
-    if (beadvec.size() > 1){
-        for (unsigned int j = 1; j < beadvec.size(); j++) {
-
-            vector<double> &entry = beadvec[j];
-            if (entry.size() != 4) throw runtime_error("Wrong number of arguments in beadvec.");
-            beads.push_back(new bead(entry[0], entry[1], entry[2], entry[3]));
-            springs.push_back(new spring(spring_length, stretching_stiffness, this, {(int)j-1, (int)j}));
-            springs[j-1]->step();
-            springs[j-1]->update_force();
-            prv_rnds.push_back(vec_randn());
+    for (unsigned int j = 0; j < beadvec.size(); j++) {
+
+        vector<double> &entry = beadvec[j];
+        if (entry.size() != 4) throw runtime_error("Wrong number of arguments in beadvec.");
+        pos[j] = {entry[0], entry[1]};
+        force[j].zero();
+        nbeads++;
+
+        if (j == 0) {
+            rad = entry[2];
+            visc = entry[3];
+            damp = 6*pi*visc*rad;
+        } else {
+            l0[j-1] = spring_length;
         }
+        prv_rnd[j] = rng_stream(rng_bead_init, offset + j).vec_n();
     }
 
+    this->update_springs();
+
     bd_prefactor = sqrt(temperature/(2*dt*damp));
 }
 
 filament::~filament()
 {
-    for (bead *b : beads) delete b;
-    for (spring *s : springs) delete s;
+    filament_network->release_beads(offset, capacity);
+}
+
+void filament::reserve_beads(int n)
+{
+    if (n <= capacity) return;
+
+    int new_capacity = max(n, 2 * capacity);
+    int new_offset = filament_network->allocate_beads(new_capacity);
+
+    vec_type *pos = filament_network->get_positions();
+    vec_type *force = filament_network->get_forces();
+    vec_type *prv_rnd = filament_network->get_prv_rnds();
+    for (int i = 0; i < nbeads; i++) {
+        pos[new_offset + i] = pos[offset + i];
+        force[new_offset + i] = force[offset + i];
+        prv_rnd[new_offset + i] = prv_rnd[offset + i];
+    }
+
+    double *l0 = filament_network->get_spring_l0s();
+    double *llen = filament_network->get_spring_lengths();
+    double *arc = filament_network->get_spring_arcs();
+    vec_type *disp = filament_network->get_spring_disps();
+    vec_type *direc = filament_network->get_spring_directions();
+    vec_type *sforce = filament_network->get_spring_forces();
+    for (int i = 0; i < nbeads - 1; i++) {
+        l0[new_offset + i] = l0[offset + i];
+        llen[new_offset + i] = llen[offset + i];
+        arc[new_offset + i] = arc[offset + i];
+        disp[new_offset + i] = disp[offset + i];
+        direc[new_offset + i] = direc[offset + i];
+        sforce[new_offset + i] = sforce[offset + i];
+    }
+
+    filament_network->release_beads(offset, capacity);
+    offset = new_offset;
+    capacity = new_capacity;
 }
 
 void filament::add_bead(vector<double> a, double spring_length, double stretching_stiffness)
 {
     if (a.size() != 4) throw runtime_error("Wrong number of arguments in bead.");
-    beads.push_back(new bead({a[0], a[1], a[2], a[3]}));
-    prv_rnds.push_back(vec_randn());
-    if (beads.size() > 1){
-        int j = (int) beads.size() - 1;
-        springs.push_back(new spring(spring_length, stretching_stiffness, this, {j-1,  j}));
-        springs[j-1]->step();
+    reserve_beads(nbeads + 1);
+    int j = nbeads;
+    filament_network->get_positions()[offset + j] = {a[0], a[1]};
+    filament_network->get_forces()[offset + j].zero();
+    filament_network->get_prv_rnds()[offset + j] = rng_stream(rng_bead_init, offset + j).vec_n();
+    nbeads++;
+    if (nbeads > 1){
+        kl = stretching_stiffness;
+        filament_network->get_spring_l0s()[offset + j - 1] = spring_length;
+        this->update_springs();
     }
     if (damp == infty) {
-        damp = beads[0]->get_friction();
+        rad = a[2];
+        visc = a[3];
+        damp = 6*pi*visc*rad;
         bd_prefactor = sqrt(temperature/(2*dt*damp));
     }
 }
 
+// 2x2 blocks of the linear system of update_positions_implicit
+struct block_type
+{
+    double xx, xy, yx, yy;
+};
+
+static block_type operator*(block_type a, block_type b)
+{
+    return {a.xx * b.xx + a.xy * b.yx, a.xx * b.xy + a.xy * b.yy,
+            a.yx * b.xx + a.yy * b.yx, a.yx * b.xy + a.yy * b.yy};
+}
+
+static vec_type operator*(block_type a, vec_type v)
+{
+    return {a.xx * v.x + a.xy * v.y, a.yx * v.x + a.yy * v.y};
+}
+
+static block_type operator-(block_type a, block_type b)
+{
+    return {a.xx - b.xx, a.xy - b.xy, a.yx - b.yx, a.yy - b.yy};
+}
+
+static block_type inverse(block_type a)
+{
+    double det = a.xx * a.yy - a.xy * a.yx;
+    return {a.yy / det, -a.xy / det, -a.yx / det, a.xx / det};
+}
+
+void filament::set_implicit_stretching(bool flag)
+{
+    implicit_stretching = flag;
+}
+
+void filament::set_rigid_links(bool flag)
+{
+    rigid_links = flag;
+    constraint_misses = 0;
+    constraint_virial.zero();
+    vec_type *sforce = filament_network->get_spring_forces() + offset;
+    for (int i = 0; i < nbeads - 1; i++) {
+        sforce[i].zero();
+    }
+}
+
+void filament::set_dt(double deltat)
+{
+    dt = deltat;
+    bd_prefactor = sqrt(temperature/(2*dt*damp));
+}
+
+double filament::get_max_drift()
+{
+    vec_type *force = filament_network->get_forces() + offset;
+    double fmax_sq = 0.0;
+    for (int i = 0; i < nbeads; i++) {
+        fmax_sq = max(fmax_sq, abs2(force[i]));
+    }
+    return sqrt(fmax_sq) / damp;
+}
+
 void filament::update_positions()
 {
-    size_t sa = beads.size();
-    for (size_t i = 0; i < sa; i++) {
-        vec_type new_rnds = vec_randn();
-        vec_type v = beads[i]->get_force() / damp + bd_prefactor * (new_rnds + prv_rnds[i]);
-        vec_type pos = beads[i]->get_pos();
-        prv_rnds[i] = new_rnds;
-        vec_type new_pos = bc->pos_bc(pos + v * dt);
-        beads[i]->set_pos(new_pos);
-        beads[i]->reset_force();
+    if (rigid_links) {
+        this->update_positions_rigid();
+        return;
+    }
+    if (implicit_stretching) {
+        this->update_positions_implicit();
+        return;
+    }
+
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *force = filament_network->get_forces() + offset;
+    vec_type *prv_rnd = filament_network->get_prv_rnds() + offset;
+    for (int i = 0; i < nbeads; i++) {
+        vec_type new_rnd = rng_stream(rng_bead_noise, offset + i).vec_n();
+        vec_type v = force[i] / damp + bd_prefactor * (new_rnd + prv_rnd[i]);
+        prv_rnd[i] = new_rnd;
+        pos[i] = bc->pos_bc(pos[i] + v * dt);
+        force[i].zero();
     }
-    for (spring *s : springs) s->step();
 }
 
-void filament::update_stretching()
+// linearly implicit step for the stretching of springs along their axes,
+// the stiff mode of the chain, with everything else explicit:
+//   (I + dt/damp K) dx = dt (force / damp + bd_prefactor (new_rnd + prv_rnd))
+// K has blocks kl d d^T of every spring, with direction d,
+// and is block tridiagonal along the chain, so it's solved by block elimination in O(nbeads)
+// without springs this is the explicit step
+//
+// the implicit step alone damps the thermal stretching of springs by 1 / (1 + dt kl / damp),
+// so each spring adds noise along its axis with covariance dt/damp K,
+// which keeps the stretching energy at equipartition for any dt
+// (exact for a harmonic chain, like the explicit step is for small dt)
+// its previous draw is redrawn from the stream of the previous step, not stored
+void filament::update_positions_implicit()
 {
-    for (spring *s : springs) {
-        s->update_force();
-        s->filament_update();
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *force = filament_network->get_forces() + offset;
+    vec_type *prv_rnd = filament_network->get_prv_rnds() + offset;
+    vec_type *direc = filament_network->get_spring_directions() + offset;
+
+    // scratch space of the thread, reused by its filaments
+    static thread_local vector<block_type> off, upper;
+    static thread_local vector<vec_type> rhs, axial;
+    off.resize(nbeads);
+    upper.resize(nbeads);
+    rhs.resize(nbeads);
+    axial.resize(nbeads);
+
+    // off diagonal blocks -h K of spring i, between beads i and i + 1
+    // and the axial noise of the spring, added to both its beads
+    double h = dt * kl / damp;
+    double sqrt_h = sqrt(h);
+    uint64_t step = get_rng_step();
+    for (int i = 0; i < nbeads - 1; i++) {
+        vec_type d = direc[i];
+        off[i] = {-h * d.x * d.x, -h * d.x * d.y, -h * d.y * d.x, -h * d.y * d.y};
+        double eta = rng_stream(rng_spring_noise, offset + i, step).n()
+            + rng_stream(rng_spring_noise, offset + i, step - 1).n();
+        axial[i] = sqrt_h * eta * d;
+    }
+
+    // forward elimination
+    // upper[i] replaces the off diagonal block after row i is divided by its pivot
+    for (int i = 0; i < nbeads; i++) {
+        vec_type new_rnd = rng_stream(rng_bead_noise, offset + i).vec_n();
+        vec_type rnd = new_rnd + prv_rnd[i];
+        if (i > 0) rnd += axial[i - 1];
+        if (i < nbeads - 1) rnd -= axial[i];
+        rhs[i] = dt * (force[i] / damp + bd_prefactor * rnd);
+        prv_rnd[i] = new_rnd;
+        force[i].zero();
+
+        block_type diag = {1.0, 0.0, 0.0, 1.0};
+        if (i > 0) diag = diag - off[i - 1];
+        if (i < nbeads - 1) diag = diag - off[i];
+        if (i > 0) {
+            diag = diag - off[i - 1] * upper[i - 1];
+            rhs[i] -= off[i - 1] * rhs[i - 1];
+        }
+        block_type inv = inverse(diag);
+        if (i < nbeads - 1) upper[i] = inv * off[i];
+        rhs[i] = inv * rhs[i];
+    }
+
+    // back substitution
+    for (int i = nbeads - 2; i >= 0; i--) {
+        rhs[i] -= upper[i] * rhs[i + 1];
+    }
+    for (int i = 0; i < nbeads; i++) {
+        pos[i] = bc->pos_bc(pos[i] + rhs[i]);
     }
 }
 
-spring *filament::get_spring(int i)
+// relative tolerance of |r_i|^2 - l0_i^2, and the most Newton iterations of a projection
+static const double constraint_tol = 1e-10;
+static const int max_constraint_iters = 50;
+
+// explicit step, then the beads are projected back onto the constraints |r_i| = l0_i
+// by constraint forces g_i d_i on bead i and -g_i d_i on bead i + 1,
+// along the spring directions d at the start of the step
+// (SHAKE for Brownian dynamics, where displacements are dt/damp times forces)
+//
+// the constraints are linearized in the multipliers g,
+// which gives a tridiagonal system along the chain, and solved by Newton iterations
+// the constraint forces are kept in the spring forces, for fracturing,
+// and their virial is added to the stretching virial
+void filament::update_positions_rigid()
 {
-    return springs[i];
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *force = filament_network->get_forces() + offset;
+    vec_type *prv_rnd = filament_network->get_prv_rnds() + offset;
+    double *l0 = filament_network->get_spring_l0s() + offset;
+    vec_type *disp = filament_network->get_spring_disps() + offset;
+    vec_type *direc = filament_network->get_spring_directions() + offset;
+    vec_type *sforce = filament_network->get_spring_forces() + offset;
+
+    // scratch space of the thread, reused by its filaments
+    static thread_local vector<vec_type> y;
+    static thread_local vector<double> sub, diag, sup, rhs, g;
+    y.resize(nbeads);
+    sub.resize(nbeads);
+    diag.resize(nbeads);
+    sup.resize(nbeads);
+    rhs.resize(nbeads);
+    g.resize(nbeads);
+
+    // unconstrained step, unwrapped along the chain
+    for (int i = 0; i < nbeads; i++) {
+        vec_type new_rnd = rng_stream(rng_bead_noise, offset + i).vec_n();
+        vec_type v = force[i] / damp + bd_prefactor * (new_rnd + prv_rnd[i]);
+        prv_rnd[i] = new_rnd;
+        y[i] = pos[i] + v * dt;
+        if (i > 0) y[i] = y[i - 1] + bc->rij_bc(y[i] - y[i - 1]);
+        force[i].zero();
+    }
+
+    int n = nbeads - 1;
+    double mobility = dt / damp;
+    for (int i = 0; i < n; i++) {
+        g[i] = 0.0;
+    }
+
+    // sigma_i = (|r_i|^2 - l0_i^2) / 2, and its derivatives in the bead displacements
+    // u = mobility * dg of every spring:
+    // r_i moves by u_{i-1} d_{i-1} - 2 u_i d_i + u_{i+1} d_{i+1}
+    constraint_misses = n;
+    for (int iter = 0; iter < max_constraint_iters && constraint_misses > 0; iter++) {
+        constraint_misses = 0;
+        for (int i = 0; i < n; i++) {
+            vec_type r = y[i + 1] - y[i];
+            double l0_sq = l0[i] * l0[i];
+            double sigma = 0.5 * (dot(r, r) - l0_sq);
+            if (fabs(sigma) > constraint_tol * l0_sq) constraint_misses++;
+            sub[i] = (i > 0) ? dot(r, direc[i - 1]) : 0.0;
+            diag[i] = -2.0 * dot(r, direc[i]);
+            sup[i] = (i < n - 1) ? dot(r, direc[i + 1]) : 0.0;
+            rhs[i] = -sigma;
+        }
+        if (constraint_misses == 0) break;
+
+        // Thomas algorithm
+        for (int i = 1; i < n; i++) {
+            double w = sub[i] / diag[i - 1];
+            diag[i] -= w * sup[i - 1];
+            rhs[i] -= w * rhs[i - 1];
+        }
+        rhs[n - 1] /= diag[n - 1];
+        for (int i = n - 2; i >= 0; i--) {
+            rhs[i] = (rhs[i] - sup[i] * rhs[i + 1]) / diag[i];
+        }
+
+        for (int i = 0; i < n; i++) {
+            g[i] += rhs[i] / mobility;
+            y[i] += rhs[i] * direc[i];
+            y[i + 1] -= rhs[i] * direc[i];
+        }
+    }
+
+    for (int i = 0; i < nbeads; i++) {
+        pos[i] = bc->pos_bc(y[i]);
+    }
+    constraint_virial.zero();
+    for (int i = 0; i < n; i++) {
+        sforce[i] = g[i] * direc[i];
+        constraint_virial += 0.5 * outer(disp[i], sforce[i]);
+    }
+}
+
+void filament::update_springs()
+{
+    vec_type *pos = filament_network->get_positions() + offset;
+    double *llen = filament_network->get_spring_lengths() + offset;
+    vec_type *disp = filament_network->get_spring_disps() + offset;
+    vec_type *direc = filament_network->get_spring_directions() + offset;
+    double *arc = filament_network->get_spring_arcs() + offset;
+    occupancy_dirty = true;
+    for (int i = 0; i < nbeads - 1; i++) {
+        disp[i] = bc->rij_bc(pos[i + 1] - pos[i]);
+        llen[i] = abs(disp[i]);
+        direc[i].zero();
+        if (llen[i] != 0.0) direc[i] = disp[i] / llen[i];
+    }
+    // cumulative from the pointed end
+    double dist = 0.0;
+    for (int i = nbeads - 2; i >= 0; i--) {
+        arc[i] = dist;
+        dist += llen[i];
+    }
+}
+
+void filament::update_stretching()
+{
+    // the constraint forces of rigid links were applied by update_positions
+    if (rigid_links) return;
+
+    vec_type *force = filament_network->get_forces() + offset;
+    double *l0 = filament_network->get_spring_l0s() + offset;
+    double *llen = filament_network->get_spring_lengths() + offset;
+    vec_type *direc = filament_network->get_spring_directions() + offset;
+    vec_type *sforce = filament_network->get_spring_forces() + offset;
+    for (int i = 0; i < nbeads - 1; i++) {
+        sforce[i] = kl * (llen[i] - l0[i]) * direc[i];
+        force[i + 0] += sforce[i];
+        force[i + 1] -= sforce[i];
+    }
 }
 
 void filament::update_d_strain(double g)
 {
-    for (bead *b : beads) {
-        vec_type pos = b->get_pos();
-        b->set_pos({pos.x + g * pos.y / bc->get_ybox(), pos.y});
+    vec_type *pos = filament_network->get_positions() + offset;
+    for (int i = 0; i < nbeads; i++) {
+        pos[i].x += g * pos[i].y / bc->get_ybox();
     }
 }
 
@@ -132,55 +450,60 @@ box *filament::get_box()
 
 vec_type filament::get_force(int i)
 {
-    return beads[i]->get_force();
+    return filament_network->get_forces()[offset + i];
 }
 
 void filament::update_forces(int index, vec_type f)
 {
-    beads[index]->update_force(f);
+    filament_network->get_forces()[offset + index] += f;
 }
 
 void filament::pull_on_ends(double f)
 {
-    if (beads.size() < 2) return;
-    int last = beads.size() - 1;
-    vec_type dr = bc->rij_bc(beads[last]->get_pos() - beads[0]->get_pos());
+    if (nbeads < 2) return;
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *force = filament_network->get_forces() + offset;
+    int last = nbeads - 1;
+    vec_type dr = bc->rij_bc(pos[last] - pos[0]);
     double len = abs(dr);
 
-    beads[ 0  ]->update_force(-0.5*f*dr/len);
-    beads[last]->update_force( 0.5*f*dr/len);
+    force[ 0  ] += -0.5*f*dr/len;
+    force[last] +=  0.5*f*dr/len;
 }
 
 void filament::affine_pull(double f)
 {
-    if (beads.size() < 2) return;
-    int last = beads.size() - 1;
-    vec_type dr = bc->rij_bc(beads[last]->get_pos() - beads[0]->get_pos());
+    if (nbeads < 2) return;
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *force = filament_network->get_forces() + offset;
+    int last = nbeads - 1;
+    vec_type dr = bc->rij_bc(pos[last] - pos[0]);
     double len = abs(dr);
     vec_type fcs = f * dr / len;
 
     for (int i = 0; i <= last; i++){
         double frac = (double(i)/double(last)-0.5);
-        beads[i]->update_force(frac * fcs);
+        force[i] += frac * fcs;
     }
 }
 
 vector<vector<double>> filament::output_beads(int fil)
 {
+    vec_type *pos = filament_network->get_positions() + offset;
     vector<vector<double>> out;
-    for (size_t i = 0; i < beads.size(); i++) {
-        out.push_back(beads[i]->output());
-        out[i].push_back(double(fil));
+    for (int i = 0; i < nbeads; i++) {
+        out.push_back({pos[i].x, pos[i].y, rad, double(fil)});
     }
     return out;
 }
 
 vector<vector<double>> filament::output_springs(int fil)
 {
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *disp = filament_network->get_spring_disps() + offset;
     vector<vector<double>> out;
-    for (size_t i = 0; i < springs.size(); i++) {
-        out.push_back(springs[i]->output());
-        out[i].push_back(double(fil));
+    for (int i = 0; i < nbeads - 1; i++) {
+        out.push_back({pos[i].x, pos[i].y, disp[i].x, disp[i].y, double(fil)});
     }
     return out;
 }
@@ -196,18 +519,21 @@ vector<double> filament::output_thermo(int fil)
 
 string filament::write_beads(int fil)
 {
+    vec_type *pos = filament_network->get_positions() + offset;
     string all_beads;
-    for (bead *b : beads) {
-        all_beads += fmt::format("{}\t{}", b->write(), fil);
+    for (int i = 0; i < nbeads; i++) {
+        all_beads += fmt::format("\n{}\t{}\t{}\t{}", pos[i].x, pos[i].y, rad, fil);
     }
     return all_beads;
 }
 
 string filament::write_springs(int fil)
 {
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *disp = filament_network->get_spring_disps() + offset;
     string all_springs;
-    for (spring *s : springs) {
-        all_springs += fmt::format("{}\t{}", s->write(), fil);
+    for (int i = 0; i < nbeads - 1; i++) {
+        all_springs += fmt::format("\n{}\t{}\t{}\t{}\t{}", pos[i].x, pos[i].y, disp[i].x, disp[i].y, fil);
     }
     return all_springs;
 }
@@ -219,81 +545,152 @@ string filament::write_thermo(int fil)
             this->get_stretching_energy(), this->get_bending_energy());
 }
 
+void filament::copy_beads(int fil, vector<double> &out)
+{
+    vec_type *pos = filament_network->get_positions() + offset;
+    for (int i = 0; i < nbeads; i++) {
+        out.insert(out.end(), {pos[i].x, pos[i].y, rad, double(fil)});
+    }
+}
+
+void filament::copy_springs(int fil, vector<double> &out)
+{
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *disp = filament_network->get_spring_disps() + offset;
+    for (int i = 0; i < nbeads - 1; i++) {
+        out.insert(out.end(), {pos[i].x, pos[i].y, disp[i].x, disp[i].y, double(fil)});
+    }
+}
+
+void filament::copy_thermo(vector<double> &out)
+{
+    out.insert(out.end(), {this->get_stretching_energy(), this->get_bending_energy()});
+}
+
 vector<vector<double>> filament::get_beads(size_t first, size_t last)
 {
+    vec_type *pos = filament_network->get_positions() + offset;
     vector<vector<double>> newbeads;
     for (size_t i = first; i < last; i++) {
-        if (i >= beads.size()) {
+        if (i >= size_t(nbeads)) {
             break;
         } else {
-            bead *b = beads[i];
-            vec_type pos = b->get_pos();
-            newbeads.push_back({pos.x, pos.y, b->get_length(), b->get_viscosity()});
+            newbeads.push_back({pos[i].x, pos[i].y, rad, visc});
         }
     }
     return newbeads;
 }
 
-vector<filament *> filament::try_fracture()
+filament *filament::try_fracture()
 {
-    for (size_t i = 0; i < springs.size(); i++) {
-        springs[i]->update_force();
-        vec_type f = springs[i]->get_force();
-        if (abs2(f) > fracture_force_sq) {
+    double *l0 = filament_network->get_spring_l0s() + offset;
+    double *llen = filament_network->get_spring_lengths() + offset;
+    vec_type *direc = filament_network->get_spring_directions() + offset;
+    vec_type *sforce = filament_network->get_spring_forces() + offset;
+    for (int i = 0; i < nbeads - 1; i++) {
+        if (!rigid_links) sforce[i] = kl * (llen[i] - l0[i]) * direc[i];
+        if (abs2(sforce[i]) > fracture_force_sq) {
             return fracture(i);
         }
     }
-    return {};
+    return nullptr;
 }
 
-vector<filament *> filament::fracture(int node){
+// splits the filament at spring node without moving any beads
+// this filament keeps beads [0, node] and the upper half takes
+// beads [node + 1, nbeads) along with the rest of the bead storage
+filament *filament::fracture(int node){
 
-    vector<filament *> newfilaments;
     cout<<"\n\tDEBUG: fracturing at node "<<node;
 
-    if(springs.size() == 0)
-        return newfilaments;
+    if(nbeads < 2)
+        return nullptr;
+
+    this->detach_all_motors();
+    this->clear_attached();
+
+    double l0 = filament_network->get_spring_l0s()[offset];
+    int nlower = node + 1;
 
-    vector<vector<double>> lower_half = this->get_beads(0, node+1);
-    vector<vector<double>> upper_half = this->get_beads(node+1, beads.size());
+    filament *upper = new filament(*this);
+    upper->offset = offset + nlower;
+    upper->nbeads = nbeads - nlower;
+    upper->capacity = capacity - nlower;
 
-    if (lower_half.size() > 0)
-        newfilaments.push_back(
-                new filament(filament_network, lower_half,
-                    springs[0]->get_l0(), springs[0]->get_kl(), kb,
-                    dt, temperature, fracture_force));
-    if (upper_half.size() > 0)
-        newfilaments.push_back(
-                new filament(filament_network, upper_half,
-                    springs[0]->get_l0(), springs[0]->get_kl(), kb,
-                    dt, temperature, fracture_force));
+    nbeads = nlower;
+    capacity = nlower;
 
-    return newfilaments;
+    this->reset_piece(l0);
+    upper->reset_piece(l0);
 
+    return upper;
+}
+
+void filament::reset_piece(double l0)
+{
+    // like new filaments, pieces don't grow,
+    // all springs take the rest length of the old barbed end,
+    // and the noise is redrawn to prevent cooling
+    spring_l0 = l0;
+    nsprings_max = 0;
+    l0_max = 0.0;
+    l0_min = 0.0;
+    kgrow = 0.0;
+    lgrow = 0.0;
+
+    ubend = 0.0;
+    bending_virial.zero();
+    constraint_virial.zero();
+
+    vec_type *force = filament_network->get_forces() + offset;
+    vec_type *prv_rnd = filament_network->get_prv_rnds() + offset;
+    double *sl0 = filament_network->get_spring_l0s() + offset;
+    for (int i = 0; i < nbeads; i++) {
+        force[i].zero();
+        prv_rnd[i] = rng_stream(rng_bead_reset, offset + i).vec_n();
+        if (i > 0) sl0[i - 1] = l0;
+    }
+
+    this->update_springs();
 }
 
 void filament::detach_all_motors()
 {
     for (size_t i = 0; i < attached.size(); i++) {
-        motor *m = attached[i].m;
+        motor_ensemble *m = attached[i].m;
+        if (!m) continue;
+        int mi = attached[i].mi;
         int hd = attached[i].hd;
-        m->detach_head_without_moving(hd);
+        m->detach_head_without_moving(mi, hd);
     }
 }
 
 bool filament::operator==(const filament& that){
 
-    if (beads.size() != that.beads.size() || springs.size() != that.springs.size())
+    if (nbeads != that.nbeads)
         return false;
 
-    for (unsigned int i = 0; i < beads.size(); i++)
-        if (!(*(beads[i]) == *(that.beads[i])))
+    if (!close(rad, that.rad, eps) || !close(visc, that.visc, eps))
+        return false;
+
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *force = filament_network->get_forces() + offset;
+    vec_type *that_pos = that.filament_network->get_positions() + that.offset;
+    vec_type *that_force = that.filament_network->get_forces() + that.offset;
+    for (int i = 0; i < nbeads; i++)
+        if (!close(pos[i].x, that_pos[i].x, eps) || !close(pos[i].y, that_pos[i].y, eps) ||
+                !close(force[i].x, that_force[i].x, eps) || !close(force[i].y, that_force[i].y, eps))
             return false;
 
-    for (unsigned int i = 0; i < springs.size(); i++)
-        if (!(springs[i]->is_similar(*(that.springs[i]))))
+    double *l0 = filament_network->get_spring_l0s() + offset;
+    double *that_l0 = that.filament_network->get_spring_l0s() + that.offset;
+    for (int i = 0; i < nbeads - 1; i++)
+        if (l0[i] != that_l0[i])
             return false;
 
+    if (kl != that.kl)
+        return false;
+
     return (this->temperature == that.temperature &&
             this->dt == that.dt && this->fracture_force == that.fracture_force);
 
@@ -301,11 +698,19 @@ bool filament::operator==(const filament& that){
 
 string filament::to_string()
 {
-    // Note: not including springs in to_string, because spring's to_string includes filament's to_string
     string out = "\n";
 
-    for (bead *b : beads) {
-        out += b->to_string();
+    vec_type *pos = filament_network->get_positions() + offset;
+    vec_type *force = filament_network->get_forces() + offset;
+    for (int i = 0; i < nbeads; i++) {
+        out += fmt::format(
+                "x : {}\t"
+                "y : {}\t"
+                "rad : {}\t"
+                "visc : {}\t"
+                "force[0] : {}\t"
+                "force[1] : {}\n",
+                pos[i].x, pos[i].y, rad, visc, force[i].x, force[i].y);
     }
 
     out += fmt::format(
@@ -319,25 +724,28 @@ string filament::to_string()
 
 void filament::update_bending()
 {
-    if (springs.size() <= 1 || kb == 0) return;
+    if (nbeads <= 2 || kb == 0) return;
+
+    vec_type *force = filament_network->get_forces() + offset;
+    vec_type *disp = filament_network->get_spring_disps() + offset;
 
     bending_virial.zero();
     ubend = 0.0;
-    for (int n = 0; n < int(springs.size())-1; n++) {
+    for (int n = 0; n < nbeads - 2; n++) {
 
-        vec_type delr1 = springs[n+0]->get_disp();
-        vec_type delr2 = springs[n+1]->get_disp();
+        vec_type delr1 = disp[n+0];
+        vec_type delr2 = disp[n+1];
 
         bend_result_type result = bend_harmonic(kb, 0.0, delr1, delr2);
 
         ubend += result.energy;
 
         // apply force to each of 3 atoms
-        beads[n+0]->update_force(-result.force1);
-        beads[n+1]->update_force(result.force1);
+        force[n+0] -= result.force1;
+        force[n+1] += result.force1;
 
-        beads[n+1]->update_force(-result.force2);
-        beads[n+2]->update_force(result.force2);
+        force[n+1] -= result.force2;
+        force[n+2] += result.force2;
 
         bending_virial += -0.5 * outer(delr1, result.force1);
         bending_virial += -0.5 * outer(delr2, result.force2);
@@ -346,11 +754,24 @@ void filament::update_bending()
 
 
 int filament::get_nbeads(){
-    return beads.size();
+    return nbeads;
+}
+
+int filament::get_offset(){
+    return offset;
 }
 
 int filament::get_nsprings(){
-    return springs.size();
+    return max(nbeads - 1, 0);
+}
+
+double filament::get_kl(){
+    return kl;
+}
+
+int filament::get_constraint_misses()
+{
+    return constraint_misses;
 }
 
 double filament::get_bending_energy(){
@@ -366,25 +787,32 @@ virial_type filament::get_bending_virial()
 
 double filament::get_stretching_energy()
 {
+    double *l0 = filament_network->get_spring_l0s() + offset;
+    double *llen = filament_network->get_spring_lengths() + offset;
     double u = 0.0;
-    for (spring *s : springs) {
-        u += s ->get_stretching_energy();
+    for (int i = 0; i < nbeads - 1; i++) {
+        u += 0.5 * kl * (llen[i] - l0[i]) * (llen[i] - l0[i]);
     }
     return u;
 }
 
 virial_type filament::get_stretching_virial()
 {
+    double *l0 = filament_network->get_spring_l0s() + offset;
+    double *llen = filament_network->get_spring_lengths() + offset;
+    vec_type *disp = filament_network->get_spring_disps() + offset;
     virial_type vir;
-    for (spring *s : springs) {
-        vir += s->get_virial();
+    for (int i = 0; i < nbeads - 1; i++) {
+        double k = kl * (llen[i] - l0[i]) / llen[i];
+        vir += 0.5 * outer(disp[i], k * disp[i]);
     }
+    if (rigid_links) vir += constraint_virial;
     return vir;
 }
 
 vec_type filament::get_bead_position(int n)
 {
-    return beads[n]->get_pos();
+    return filament_network->get_positions()[offset + n];
 }
 
 void filament::print_thermo()
@@ -396,10 +824,11 @@ void filament::print_thermo()
 
 double filament::get_end2end()
 {
-    if (beads.size() < 2) {
+    if (nbeads < 2) {
         return 0;
     } else {
-        return bc->dist_bc(beads[beads.size() - 1]->get_pos() - beads[0]->get_pos());
+        vec_type *pos = filament_network->get_positions() + offset;
+        return bc->dist_bc(pos[nbeads - 1] - pos[0]);
     }
 }
 
@@ -422,44 +851,47 @@ void filament::set_l0_min(double lmin)
 
 void filament::grow(double dL)
 {
-    double lb = springs[0]->get_l0();
+    double lb = filament_network->get_spring_l0s()[offset];
 
     if (lb + dL < l0_max) {
         // make spring "0" longer
-        springs[0]->set_l0(lb + dL);
-        springs[0]->step();
+        filament_network->get_spring_l0s()[offset] = lb + dL;
 
     } else {
 
-        vec_type dir = springs[0]->get_direction();
-        vec_type p2 = beads[1]->get_pos();
+        vec_type dir = filament_network->get_spring_directions()[offset];
+        vec_type p2 = this->get_bead_position(1);
 
         // split spring "0" into two
 
         // add a new bead "1" to split spring "0"
-        vec_type newpos = bc->pos_bc(p2 - spring_l0 * dir);
-        bead *b = new bead(
-                newpos.x, newpos.y,
-                beads[0]->get_length(), beads[0]->get_viscosity());
-        beads.insert(beads.begin() + 1, b);
-        prv_rnds.insert(prv_rnds.begin() + 1, vec_randn());
-
-        // shift all springs forward, except the first one
-        for (size_t i = 1; i < springs.size(); i++) {
-            springs[i]->inc_aindex();
+        // by shifting beads 1, 2, ... forward
+        reserve_beads(nbeads + 1);
+        vec_type *pos = filament_network->get_positions() + offset;
+        vec_type *force = filament_network->get_forces() + offset;
+        vec_type *prv_rnd = filament_network->get_prv_rnds() + offset;
+        for (int i = nbeads; i > 1; i--) {
+            pos[i] = pos[i - 1];
+            force[i] = force[i - 1];
+            prv_rnd[i] = prv_rnd[i - 1];
         }
-
-        // add new spring "1" with length l0
-        spring *s = new spring(spring_l0, springs[0]->get_kl(), this, {1, 2});
-        springs.insert(springs.begin() + 1, s);
+        nbeads++;
+        pos[1] = bc->pos_bc(p2 - spring_l0 * dir);
+        force[1].zero();
+        prv_rnd[1] = rng_stream(rng_bead_grow, offset + 1).vec_n();
+
+        // shift all springs forward, except the first one,
+        // and add new spring "1" with length l0
+        double *l0 = filament_network->get_spring_l0s() + offset;
+        for (int i = nbeads - 2; i > 1; i--) {
+            l0[i] = l0[i - 1];
+        }
+        l0[1] = spring_l0;
 
         // set spring at barbed end to remaining length
-        springs[0]->set_l0(lb + dL - spring_l0);
+        l0[0] = lb + dL - spring_l0;
 
-        // update springs (I think only springs "0" and "1" need updating)
-        for (spring *s : springs) {
-            s->step();
-        }
+        this->update_springs();
 
         // fix attached points
         for (auto &a : attached) {
@@ -482,7 +914,7 @@ void filament::grow(double dL)
 
 void filament::update_length()
 {
-    if ( kgrow*lgrow > 0 && this->get_nsprings() + 1 <= nsprings_max && rng_u() < kgrow*dt){
+    if ( kgrow*lgrow > 0 && this->get_nsprings() + 1 <= nsprings_max && rng_stream(rng_filament_grow, offset).u() < kgrow*dt){
         grow(lgrow);
     }
 }
@@ -501,25 +933,46 @@ void filament::set_lgrow(double dl){
 
 // pos = distance from pointed end, relative to bead[l + 1]
 
-int filament::new_attached(motor *m, int hd, int l, vec_type intpoint)
+int filament::new_attached(motor_ensemble *m, int mi, int hd, int l, vec_type intpoint)
 {
-    double pos = bc->dist_bc(springs[l]->get_h1() - intpoint);
-    // length of attached is usually short,
-    // so this isn't very expensive
-    for (size_t i = 0; i < attached.size(); i++) {
-        if (!attached[i].m) {
-            attached[i] = {m, hd, l, pos};
-            return int(i);
-        }
+    double pos = bc->dist_bc(this->get_bead_position(l + 1) - intpoint);
+    occupancy_dirty = true;
+    if (free_attached.size() > 0) {
+        int i = free_attached.back();
+        free_attached.pop_back();
+        attached[i] = {m, mi, hd, l, pos};
+        return i;
     }
-    size_t j = attached.size();
-    attached.push_back({m, hd, l, pos});
-    return int(j);
+    attached.push_back({m, mi, hd, l, pos});
+    return int(attached.size()) - 1;
 }
 
 void filament::del_attached(int i)
 {
-    attached[i] = {nullptr, -1, -1, NAN};
+    attached[i] = {nullptr, -1, -1, -1, NAN};
+    free_attached.push_back(i);
+    occupancy_dirty = true;
+}
+
+void filament::clear_attached()
+{
+    attached.clear();
+    free_attached.clear();
+    occupancy.clear();
+    occupancy_dirty = false;
+}
+
+void filament::update_occupancy()
+{
+    if (!occupancy_dirty) return;
+    occupancy.clear();
+    for (size_t i = 0; i < attached.size(); i++) {
+        if (attached[i].m) {
+            occupancy.push_back({this->get_attached_distance(i), int(i)});
+        }
+    }
+    sort(occupancy.begin(), occupancy.end());
+    occupancy_dirty = false;
 }
 
 int filament::get_attached_l(int i)
@@ -531,18 +984,25 @@ vec_type filament::get_attached_pos(int i)
 {
     int l = attached[i].l;
     double pos = attached[i].pos;
-    vec_type h1 = springs[l]->get_h1();
-    vec_type dir = springs[l]->get_direction();
+    vec_type h1 = this->get_bead_position(l + 1);
+    vec_type dir = filament_network->get_spring_directions()[offset + l];
     return bc->pos_bc(h1 - pos * dir);
 }
 
-void filament::add_attached_force(int i, vec_type f)
+// Using the lever rule to propagate force as outlined in Nedelec F 2002
+void filament::gather_attached_forces(motor_ensemble *m)
 {
-    int l = attached[i].l;
-    double pos = attached[i].pos;
-    double ratio = pos / springs[l]->get_length();
-    beads[l + 0]->update_force(f * ratio);
-    beads[l + 1]->update_force(f * (1.0 - ratio));
+    double *llen = filament_network->get_spring_lengths() + offset;
+    vec_type *force = filament_network->get_forces() + offset;
+    for (attached_type &a : attached) {
+        if (a.m != m) continue;
+        array<vec_type, 2> f = m->get_filament_forces(a.mi, a.hd);
+        double ratio = a.pos / llen[a.l];
+        force[a.l + 0] += f[0] * ratio;
+        force[a.l + 1] += f[0] * (1.0 - ratio);
+        force[a.l + 0] -= f[1];
+        force[a.l + 1] += f[1];
+    }
 }
 
 void filament::add_attached_pos(int i, double dist)
@@ -550,8 +1010,10 @@ void filament::add_attached_pos(int i, double dist)
     int &l = attached[i].l;
     double &pos = attached[i].pos;
     pos += dist;
+    occupancy_dirty = true;
 
-    double len = springs[l]->get_l0();
+    double *l0 = filament_network->get_spring_l0s() + offset;
+    double len = l0[l];
     if (pos >= len) {
         // pos is after spring
         if (l == 0) {
@@ -565,50 +1027,55 @@ void filament::add_attached_pos(int i, double dist)
         }
     } else if (pos < 0.0) {
         // pos is before spring
-        if (l + 1 == int(springs.size())) {
+        if (l + 1 == nbeads - 1) {
             // at pointed end
             pos = 0.0;
         } else {
             // move to previous spring
             l += 1;
             // add NEW spring length
-            pos += springs[l]->get_l0();
+            pos += l0[l];
         }
     }
 }
 
 bool filament::at_barbed_end(int i)
 {
-    return attached[i].l == 0 && attached[i].pos == springs[attached[i].l]->get_l0();
+    return attached[i].l == 0 && attached[i].pos == filament_network->get_spring_l0s()[offset];
 }
 
 bool filament::at_pointed_end(int i)
 {
-    return attached[i].l + 1 == int(springs.size()) && attached[i].pos == 0.0;
+    return attached[i].l + 1 == nbeads - 1 && attached[i].pos == 0.0;
 }
 
 double filament::distance_from_pointed_end(int l, double pos)
 {
-    double dist = 0.0;
-    for (size_t i = springs.size() - 1; i > l; i--) {
-        dist += springs[i]->get_length();
-    }
-    return dist + pos;
+    return filament_network->get_spring_arcs()[offset + l] + pos;
+}
+
+double filament::get_attached_distance(int i)
+{
+    return this->distance_from_pointed_end(attached[i].l, attached[i].pos);
 }
 
+// distance along the filament to the nearest attached head,
+// which is one of the neighbors of intpoint in the occupancy index
 double filament::closest_attached_distance(int l, vec_type intpoint)
 {
-    double ref_pos = bc->dist_bc(springs[l]->get_h1() - intpoint);
+    double ref_pos = bc->dist_bc(this->get_bead_position(l + 1) - intpoint);
     double ref_dist = this->distance_from_pointed_end(l, ref_pos);
+
+    this->update_occupancy();
+    auto it = lower_bound(occupancy.begin(), occupancy.end(), make_pair(ref_dist, -1));
+
     double min_delta = INFINITY;
-    for (size_t i = 0; i < attached.size(); i++) {
-        if (attached[i].m) {
-            double dist = this->distance_from_pointed_end(attached[i].l, attached[i].pos);
-            double delta = fabs(dist - ref_dist);
-            if (delta < min_delta) {
-                min_delta = delta;
-            }
-        }
+    if (it != occupancy.end()) {
+        min_delta = fabs(it->first - ref_dist);
+    }
+    if (it != occupancy.begin()) {
+        double delta = fabs((it - 1)->first - ref_dist);
+        if (delta < min_delta) min_delta = delta;
     }
     return min_delta;
 }
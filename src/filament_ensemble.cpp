@@ -48,6 +48,14 @@ filament_ensemble::filament_ensemble(box *bc_, vector<vector<double> > beads, ar
     }
 
     quads = new quadrants(bc, mynq);
+    quad_incremental = false;
+    quad_skin = 0.0;
+    quad_rebuilds = 0;
+    quad_ref_delrx = 0.0;
+
+    frozen = false;
+    frozen_valid = false;
+    frozen_delrx = 0.0;
 
     pe_stretch = 0;
     pe_bend = 0;
@@ -68,6 +76,30 @@ void filament_ensemble::set_external(external *ext_)
     ext = ext_;
 }
 
+void filament_ensemble::set_implicit_stretching(bool flag)
+{
+    for (filament *f : network)
+        f->set_implicit_stretching(flag);
+}
+
+void filament_ensemble::set_rigid_links(bool flag)
+{
+    for (filament *f : network)
+        f->set_rigid_links(flag);
+}
+
+void filament_ensemble::set_dt(double dt)
+{
+    for (filament *f : network)
+        f->set_dt(dt);
+}
+
+void filament_ensemble::set_frozen(bool flag)
+{
+    frozen = flag;
+    frozen_valid = false;
+}
+
 // begin [quadrants]
 
 quadrants *filament_ensemble::get_quads()
@@ -79,12 +111,121 @@ void filament_ensemble::quad_update_serial()
 {
     quads->clear();
     for (int f = 0; f < int(network.size()); f++) {
+        int offset = network[f]->get_offset();
+        for (int l = 0; l < network[f]->get_nsprings(); l++) {
+            int s = offset + l;
+            quads->add_spring(bead_pos[s], bead_pos[s + 1], spring_disp[s], {f, l});
+        }
+    }
+    if (exv && !frozen) quads->build_pairs();
+    this->quads_built();
+}
+
+// same quadrants as quad_update_serial, binned by all threads
+void filament_ensemble::quad_update_parallel()
+{
+    quads->clear();
+    quad_fl.clear();
+    quad_index.clear();
+    for (int f = 0; f < int(network.size()); f++) {
+        int offset = network[f]->get_offset();
+        for (int l = 0; l < network[f]->get_nsprings(); l++) {
+            quad_fl.push_back({f, l});
+            quad_index.push_back(offset + l);
+        }
+    }
+    quads->add_springs(quad_fl, quad_index, bead_pos.data(), spring_disp.data());
+    if (exv && !frozen) quads->build_pairs();
+    this->quads_built();
+}
+
+// springs are identified by their index in the spring storage,
+// which only changes when a filament grows, fractures or is moved in storage
+// growth and fracture show up as springs being inserted, removed or renumbered
+void filament_ensemble::quad_update_incremental()
+{
+    quads->begin_update();
+    for (int f = 0; f < int(network.size()); f++) {
+        int offset = network[f]->get_offset();
         for (int l = 0; l < network[f]->get_nsprings(); l++) {
-            spring *s = network[f]->get_spring(l);
-            quads->add_spring(s, {f, l});
+            int s = offset + l;
+            quads->update_spring(s, bead_pos[s], bead_pos[s + 1], spring_disp[s], {f, l});
         }
     }
-    if (exv) quads->build_pairs();
+    quads->end_update();
+    if (exv && !frozen) quads->build_pairs();
+    this->quads_built();
+}
+
+void filament_ensemble::quad_update()
+{
+    if (quad_incremental)
+        this->quad_update_incremental();
+    else if (get_max_threads() > 1)
+        this->quad_update_parallel();
+    else
+        this->quad_update_serial();
+}
+
+void filament_ensemble::set_quad_incremental(bool flag)
+{
+    quad_incremental = flag;
+}
+
+void filament_ensemble::quads_built()
+{
+    quad_rebuilds++;
+
+    if (quad_skin > 0.0) {
+        quad_ref_pos = bead_pos;
+        quad_ref_layout = this->get_layout();
+        quad_ref_delrx = bc->get_delrx();
+    }
+}
+
+vector<array<int, 2>> filament_ensemble::get_layout()
+{
+    vector<array<int, 2>> layout;
+    for (filament *f : network)
+        layout.push_back({f->get_offset(), f->get_nbeads()});
+    return layout;
+}
+
+void filament_ensemble::set_quad_skin(double skin)
+{
+    quad_skin = skin;
+    quads->set_skin(skin);
+    quad_ref_layout.clear();
+}
+
+bool filament_ensemble::quad_update_verlet()
+{
+    if (!this->quads_expired()) return false;
+    this->quad_update();
+    return true;
+}
+
+// two springs approach each other by at most twice the largest bead displacement,
+// and a change in shear moves their periodic images by at most the change in delrx
+bool filament_ensemble::quads_expired()
+{
+    if (quad_ref_layout.size() != network.size()) return true;
+
+    double max_disp_sq = 0.0;
+    for (size_t f = 0; f < network.size(); f++) {
+        int first = network[f]->get_offset();
+        int n = network[f]->get_nbeads();
+        if (quad_ref_layout[f][0] != first || quad_ref_layout[f][1] != n) return true;
+        for (int i = first; i < first + n; i++)
+            max_disp_sq = max(max_disp_sq, abs2(bc->rij_bc(bead_pos[i] - quad_ref_pos[i])));
+    }
+    double shift = fabs(bc->get_delrx() - quad_ref_delrx);
+    return sqrt(max_disp_sq) + shift > 0.5 * quad_skin;
+}
+
+int filament_ensemble::get_quad_rebuilds()
+{
+    return quad_rebuilds;
 }
 
 vector<array<int, 2>> *filament_ensemble::get_attach_list(vec_type pos)
@@ -92,6 +233,32 @@ vector<array<int, 2>> *filament_ensemble::get_attach_list(vec_type pos)
     return quads->get_attach_list(pos);
 }
 
+bool filament_ensemble::quad_update_frozen(bool serial)
+{
+    if (frozen_valid && bc->get_delrx() == frozen_delrx) return false;
+
+    if (serial)
+        this->quad_update_serial();
+    else
+        this->quad_update();
+
+    frozen_axis.resize(spring_disp.size());
+    frozen_l2.resize(spring_disp.size());
+    int nfil = network.size();
+    #pragma omp parallel for schedule(static)
+    for (int f = 0; f < nfil; f++) {
+        int offset = network[f]->get_offset();
+        for (int l = 0; l < network[f]->get_nsprings(); l++) {
+            int s = offset + l;
+            frozen_axis[s] = bc->rij_bc(bead_pos[s + 1] - bead_pos[s]);
+            frozen_l2[s] = abs2(spring_disp[s]);
+        }
+    }
+    frozen_valid = true;
+    frozen_delrx = bc->get_delrx();
+    return true;
+}
+
 // end [quadrants]
 
 vector<filament *>* filament_ensemble::get_network()
@@ -106,22 +273,32 @@ filament * filament_ensemble::get_filament(int index)
 
 double filament_ensemble::get_llength(int fil, int spring)
 {
-    return network[fil]->get_spring(spring)->get_length();
+    return spring_len[network[fil]->get_offset() + spring];
 }
 
 vec_type filament_ensemble::get_start(int fil, int spring)
 {
-    return network[fil]->get_spring(spring)->get_h0();
+    return bead_pos[network[fil]->get_offset() + spring];
 }
 
 vec_type filament_ensemble::get_end(int fil, int spring)
 {
-    return network[fil]->get_spring(spring)->get_h1();
+    return bead_pos[network[fil]->get_offset() + spring + 1];
 }
 
 vec_type filament_ensemble::get_direction(int fil, int spring)
 {
-    return network[fil]->get_spring(spring)->get_direction();
+    return spring_direc[network[fil]->get_offset() + spring];
+}
+
+vec_type filament_ensemble::get_disp(int fil, int spring)
+{
+    return spring_disp[network[fil]->get_offset() + spring];
+}
+
+vec_type filament_ensemble::get_intpoint(int fil, int spring, vec_type pos)
+{
+    return this->intpoint(network[fil]->get_offset() + spring, pos);
 }
 
 vec_type filament_ensemble::get_force(int fil, int spring)
@@ -155,12 +332,177 @@ int filament_ensemble::get_nfilaments(){
     return network.size();
 }
 
+double filament_ensemble::get_max_drift()
+{
+    int nfil = network.size();
+    double drift = 0.0;
+    #pragma omp parallel for schedule(static) reduction(max:drift)
+    for (int f = 0; f < nfil; f++) {
+        drift = max(drift, network[f]->get_max_drift());
+    }
+    return drift;
+}
+
+// begin [bead storage]
+
+// returns the offset of a range of n beads
+// released ranges are reused first, so fracture and growth
+// don't usually need to grow the storage
+// if the storage grows, pointers returned by get_positions etc. are invalidated
+int filament_ensemble::allocate_beads(int n)
+{
+    for (size_t i = 0; i < free_beads.size(); i++) {
+        if (free_beads[i][1] >= n) {
+            int offset = free_beads[i][0];
+            free_beads[i][0] += n;
+            free_beads[i][1] -= n;
+            if (free_beads[i][1] == 0) free_beads.erase(free_beads.begin() + i);
+            return offset;
+        }
+    }
+
+    int offset = bead_pos.size();
+    bead_pos.resize(offset + n);
+    bead_force.resize(offset + n);
+    bead_prv_rnd.resize(offset + n);
+    spring_l0.resize(offset + n);
+    spring_len.resize(offset + n);
+    spring_arc.resize(offset + n);
+    spring_disp.resize(offset + n);
+    spring_direc.resize(offset + n);
+    spring_force.resize(offset + n);
+    return offset;
+}
+
+// returns a range of beads for reuse,
+// merging it with its neighbors
+void filament_ensemble::release_beads(int offset, int n)
+{
+    if (n <= 0) return;
+    array<int, 2> range = {offset, n};
+    auto it = lower_bound(free_beads.begin(), free_beads.end(), range);
+    it = free_beads.insert(it, range);
+    auto next = it + 1;
+    if (next != free_beads.end() && (*it)[0] + (*it)[1] == (*next)[0]) {
+        (*it)[1] += (*next)[1];
+        free_beads.erase(next);
+    }
+    if (it != free_beads.begin()) {
+        auto prev = it - 1;
+        if ((*prev)[0] + (*prev)[1] == (*it)[0]) {
+            (*prev)[1] += (*it)[1];
+            free_beads.erase(it);
+        }
+    }
+}
+
+vec_type *filament_ensemble::get_positions()
+{
+    return bead_pos.data();
+}
+
+vec_type *filament_ensemble::get_forces()
+{
+    return bead_force.data();
+}
+
+vec_type *filament_ensemble::get_prv_rnds()
+{
+    return bead_prv_rnd.data();
+}
+
+double *filament_ensemble::get_spring_l0s()
+{
+    return spring_l0.data();
+}
+
+double *filament_ensemble::get_spring_lengths()
+{
+    return spring_len.data();
+}
+
+vec_type *filament_ensemble::get_spring_disps()
+{
+    return spring_disp.data();
+}
+
+vec_type *filament_ensemble::get_spring_directions()
+{
+    return spring_direc.data();
+}
+
+vec_type *filament_ensemble::get_spring_forces()
+{
+    return spring_force.data();
+}
+
+double *filament_ensemble::get_spring_arcs()
+{
+    return spring_arc.data();
+}
+
+//shortest(perpendicular) distance between an arbitrary point and spring s
+//SO : 849211
+vec_type filament_ensemble::intpoint(int s, vec_type pos)
+{
+    vec_type h0 = bead_pos[s];
+    vec_type h1 = bead_pos[s + 1];
+    vec_type disp = spring_disp[s];
+    double l2 = (frozen_valid) ? frozen_l2[s] : abs2(disp);
+    if (l2 == 0) {
+        return h0;
+    } else {
+        //Consider the line extending the spring, parameterized as h0 + tp ( h1 - h0 )
+        //tp = projection of pos onto the line
+        double tp;
+        if (frozen_valid)
+            tp = dot(bc->rij_bc(pos - h0), frozen_axis[s])/l2;
+        else
+            tp = bc->dot_bc(pos - h0, h1 - h0)/l2;
+        if (tp < 0.0) {
+            return h0;
+        } else if (tp > 1.0 ) {
+            return h1;
+        } else{
+            return bc->pos_bc(h0 + tp * disp);
+        }
+    }
+}
+
+bool filament_ensemble::line_intersect(int s1, int s2)
+{
+    //Reference to Stack Overflow entry by iMalc on Feb 10, 2013
+    //Web Address: https://stackoverflow.com/questions/563198/how-do-you-detect-where-two-line-segments-intersect
+
+    vec_type disp1 = spring_disp[s1];
+    vec_type disp2 = spring_disp[s2];
+
+    vec_type disp12 = bc->rij_bc(bead_pos[s1] - bead_pos[s2]);
+
+    double denom = disp1.x*disp2.y - disp1.y*disp2.x;
+    if (denom == 0) return false;
+    bool denomPos = denom > 0;
+
+    double s_num = disp1.x*disp12.y - disp1.y*disp12.x;
+    double t_num = disp2.x*disp12.y - disp2.y*disp12.x;
+
+    if ((s_num < 0) == denomPos) return false;
+    if ((t_num < 0) == denomPos) return false;
+
+    if (((s_num > denom) == denomPos) || ((t_num > denom) == denomPos)) return false;
+
+    //Else Collision have been detected, the filaments do intersect!
+    return true;
+}
+
+// end [bead storage]
+
 // begin [attached]
 
 fp_index_type filament_ensemble::new_attached(
-        motor *m, int hd, int f_index, int l_index, vec_type pos)
+        motor_ensemble *m, int mi, int hd, int f_index, int l_index, vec_type pos)
 {
-    int p_index = network[f_index]->new_attached(m, hd, l_index, pos);
+    int p_index = network[f_index]->new_attached(m, mi, hd, l_index, pos);
     return {f_index, p_index};
 }
 
@@ -180,9 +522,16 @@ vec_type filament_ensemble::get_attached_pos(fp_index_type i)
     return network[i.f_index]->get_attached_pos(i.p_index);
 }
 
-void filament_ensemble::add_attached_force(fp_index_type i, vec_type f)
+void filament_ensemble::gather_attached_forces(motor_ensemble *m)
 {
-    network[i.f_index]->add_attached_force(i.p_index, f);
+    // nothing would clear or use them
+    if (frozen) return;
+
+    int nfil = network.size();
+    #pragma omp parallel for schedule(static)
+    for (int f = 0; f < nfil; f++) {
+        network[f]->gather_attached_forces(m);
+    }
 }
 
 void filament_ensemble::add_attached_pos(fp_index_type i, double dist)
@@ -197,6 +546,11 @@ vec_type filament_ensemble::get_attached_direction(fp_index_type i)
     return get_direction(f_index, l_index);
 }
 
+double filament_ensemble::get_attached_distance(fp_index_type i)
+{
+    return network[i.f_index]->get_attached_distance(i.p_index);
+}
+
 bool filament_ensemble::at_barbed_end(fp_index_type i)
 {
     return network[i.f_index]->at_barbed_end(i.p_index);
@@ -260,6 +614,27 @@ void filament_ensemble::write_thermo(ofstream& fout){
 
 }
 
+void filament_ensemble::copy_beads(vector<double> &out)
+{
+    out.clear();
+    for (size_t i = 0; i < network.size(); i++)
+        network[i]->copy_beads(i, out);
+}
+
+void filament_ensemble::copy_springs(vector<double> &out)
+{
+    out.clear();
+    for (size_t i = 0; i < network.size(); i++)
+        network[i]->copy_springs(i, out);
+}
+
+void filament_ensemble::copy_thermo(vector<double> &out)
+{
+    out.clear();
+    for (size_t i = 0; i < network.size(); i++)
+        network[i]->copy_thermo(out);
+}
+
 void filament_ensemble::print_filament_thermo()
 {
     for (size_t i = 0; i < network.size(); i++) {
@@ -268,9 +643,9 @@ void filament_ensemble::print_filament_thermo()
     }
 }
 
-void filament_ensemble::print_network_thermo()
+void filament_ensemble::print_network_thermo(ostream &out)
 {
-    fmt::print(
+    fmt::print(out,
             "\n"
             "All Filaments\t:\t"
             "PEs = {}\t"
@@ -296,17 +671,33 @@ void filament_ensemble::print_filament_lengths()
 // update stretching and bending energies/virials
 // Note: excluded volume and external energies/virials
 // are already updated along with their forces
+// per-filament terms are computed in parallel and summed in filament order,
+// so the totals don't depend on the number of threads
 void filament_ensemble::update_energies()
 {
+    int nfil = network.size();
+    fil_pe_stretch.resize(nfil);
+    fil_pe_bend.resize(nfil);
+    fil_vir_stretch.resize(nfil);
+    fil_vir_bend.resize(nfil);
+
+    #pragma omp parallel for schedule(static)
+    for (int f = 0; f < nfil; f++) {
+        fil_pe_bend[f] = network[f]->get_bending_energy();
+        fil_pe_stretch[f] = network[f]->get_stretching_energy();
+        fil_vir_stretch[f] = network[f]->get_stretching_virial();
+        fil_vir_bend[f] = network[f]->get_bending_virial();
+    }
+
     pe_stretch = 0.0;
     pe_bend = 0.0;
     vir_stretch.zero();
     vir_bend.zero();
-    for (filament *f : network) {
-        pe_bend += f->get_bending_energy();
-        pe_stretch += f->get_stretching_energy();
-        vir_stretch += f->get_stretching_virial();
-        vir_bend += f->get_bending_virial();
+    for (int f = 0; f < nfil; f++) {
+        pe_bend += fil_pe_bend[f];
+        pe_stretch += fil_pe_stretch[f];
+        vir_stretch += fil_vir_stretch[f];
+        vir_bend += fil_vir_bend[f];
     }
 }
 
@@ -360,6 +751,14 @@ virial_type filament_ensemble::get_external_virial()
     return vir_ext;
 }
 
+int filament_ensemble::get_constraint_misses()
+{
+    int misses = 0;
+    for (filament *f : network)
+        misses += f->get_constraint_misses();
+    return misses;
+}
+
 // end [thermo]
 
 // begin [monte carlo]
@@ -387,15 +786,10 @@ void filament_ensemble::try_fracture() {
     // fractured filaments are added to the end of network,
     // so they can be fractured again
     for (size_t i = 0; i < network.size(); i++) {
-        vector<filament *> newfilaments = network[i]->try_fracture();
-        if (newfilaments.size() > 0) {
-            filament *broken = network[i];
-            network[i] = newfilaments[0];
-            for (size_t i = 1; i < newfilaments.size(); i++) {
-                network.push_back(newfilaments[i]);
-            }
-            broken->detach_all_motors();
-            delete broken;
+        // the lower half stays in place, and the upper half is added
+        filament *upper = network[i]->try_fracture();
+        if (upper) {
+            network.push_back(upper);
         }
     }
 }
@@ -411,18 +805,38 @@ void filament_ensemble::montecarlo()
 // begin [dynamics]
 
 // Overdamped Langevin Dynamics Integrator (Leimkuhler, 2013)
+// each bead draws noise from its own stream,
+// so trajectories don't depend on the number of threads
 void filament_ensemble::integrate()
 {
-    for (filament *f : network) {
-        f->update_positions();
+    int nfil = network.size();
+    #pragma omp parallel for schedule(static)
+    for (int f = 0; f < nfil; f++) {
+        network[f]->update_positions();
+        network[f]->update_springs();
+    }
+}
+
+// recomputes all spring displacements in one pass,
+// after bead positions change
+void filament_ensemble::update_springs()
+{
+    int nfil = network.size();
+    #pragma omp parallel for schedule(static)
+    for (int f = 0; f < nfil; f++) {
+        network[f]->update_springs();
     }
 }
 
 void filament_ensemble::update_d_strain(double g)
 {
-    for (filament *f : network) {
-        f->update_d_strain(g);
+    int nfil = network.size();
+    #pragma omp parallel for schedule(static)
+    for (int f = 0; f < nfil; f++) {
+        network[f]->update_d_strain(g);
+        network[f]->update_springs();
     }
+    if (g != 0.0) frozen_valid = false;
 }
 
 // end [dynamics]
@@ -438,17 +852,57 @@ void filament_ensemble::compute_forces()
     this->update_energies();
 }
 
+// the slow forces are added to their own array, which is held until the next call
+void filament_ensemble::compute_slow_forces()
+{
+    bead_slow_force.assign(bead_pos.size(), vec_type());
+    swap(bead_force, bead_slow_force);
+    this->update_excluded_volume();
+    this->update_external();
+    swap(bead_force, bead_slow_force);
+    slow_ref_layout = this->get_layout();
+}
+
+void filament_ensemble::compute_fast_forces()
+{
+    this->update_stretching();
+    this->update_bending();
+    this->update_energies();
+}
+
+void filament_ensemble::add_slow_forces()
+{
+    int nfil = network.size();
+    #pragma omp parallel for schedule(static)
+    for (int f = 0; f < nfil; f++) {
+        int first = network[f]->get_offset();
+        int last = first + network[f]->get_nbeads();
+        for (int i = first; i < last; i++)
+            bead_force[i] += bead_slow_force[i];
+    }
+}
+
+bool filament_ensemble::slow_forces_expired()
+{
+    return slow_ref_layout != this->get_layout();
+}
+
+// each filament only writes the forces on its own beads
 void filament_ensemble::update_bending()
 {
-    for (filament *f : network) {
-        f->update_bending();
+    int nfil = network.size();
+    #pragma omp parallel for schedule(static)
+    for (int f = 0; f < nfil; f++) {
+        network[f]->update_bending();
     }
 }
 
 void filament_ensemble::update_stretching()
 {
-    for (filament *f : network) {
-        f->update_stretching();
+    int nfil = network.size();
+    #pragma omp parallel for schedule(static)
+    for (int f = 0; f < nfil; f++) {
+        network[f]->update_stretching();
     }
 }
 
@@ -462,7 +916,7 @@ void filament_ensemble::update_excluded_volume()
     pe_exv = 0.0;
     vir_ext.zero();
     if (exv) {
-        exv->update_spring_forces_from_quads(quads, network);
+        exv->update_spring_forces_from_quads(quads, this);
         pe_exv = exv->get_pe_exv();
         vir_exv = exv->get_vir_exv();
     }
@@ -473,13 +927,14 @@ void filament_ensemble::update_external()
     pe_ext = 0.0;
     vir_ext.zero();
     if (ext) {
-        for (size_t f = 0; f < network.size(); f++) {
-            for (int i = 0; i < network[f]->get_nbeads(); i++) {
-                vec_type pos = network[f]->get_bead_position(i);
-                ext_result_type result = ext->compute(pos);
+        for (filament *f : network) {
+            int first = f->get_offset();
+            int last = first + f->get_nbeads();
+            for (int i = first; i < last; i++) {
+                ext_result_type result = ext->compute(bead_pos[i]);
                 pe_ext += result.energy;
                 vir_ext += result.virial;
-                this->update_forces(f, i, result.force);
+                bead_force[i] += result.force;
             }
         }
     }
@@ -10,7 +10,7 @@ vector<vector<double>> generate_filament_ensemble(
     if (seed == -1) {
         is_straight = true;
     } else {
-        srand(seed);
+        set_seed(seed);
     }
     binomial_distribution<int> distribution(nbeads_extra, nbeads_extra_prob);
     default_random_engine generator(seed + 2);
@@ -51,7 +51,7 @@ vector<vector<double>> generate_filament_ensemble(
     if (seed == -1) {
         is_straight = true;
     } else {
-        srand(seed);
+        set_seed(seed);
     }
     array<double, 2> fov = bc->get_fov();
     int npolymer = ceil(density * fov[0] * fov[1]) / nbeads;
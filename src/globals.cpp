@@ -14,15 +14,26 @@
 #include "globals.h"
 #include <boost/range/irange.hpp>
 /* distances in microns, time in seconds, forces in pN */
-mt19937_64 generator;
-normal_distribution<double> distribution(0,1);
-//uniform_real_distribution<double> distribution(-0.5,0.5);
+rng_state::rng_state() : seed(0), step(0), ntags(0), sequential(rng_sequential, 0, 0) {}
+
+static rng_state process_rng;
+static thread_local rng_state *thread_rng = nullptr;
+
+static rng_state &current_rng()
+{
+    return thread_rng ? *thread_rng : process_rng;
+}
+
+void bind_rng_state(rng_state *state)
+{
+    thread_rng = state;
+}
 
 /*generic functions to be used below*/
 
 double rng_u()
 {
-    return (double)rand()/(RAND_MAX);
+    return current_rng().sequential.u();
 }
 
 int pr(int num)
@@ -37,25 +48,39 @@ int pr(int num)
 
 double rng_exp(double mean)
 {
-    double u;
-    u=rand() / (RAND_MAX + 1.);
-    return  -mean*log(u);
+    return -mean*log(current_rng().sequential.u());
 }
 
 void set_seed(int s){
-    generator.seed(s);
-    srand(s);
+    rng_state &rng = current_rng();
+    rng.seed = s;
+    rng.sequential = rng_stream(rng_sequential, 0, 0);
 }
 
-double rng_n()
+int get_seed()
+{
+    return current_rng().seed;
+}
+
+void set_rng_step(uint64_t step)
 {
-    return distribution(generator);
+    current_rng().step = step;
+}
 
+uint64_t get_rng_step()
+{
+    return current_rng().step;
 }
 
-mt19937_64 &get_rng()
+uint32_t new_rng_tag()
 {
-    return generator;
+    return ++current_rng().ntags << 16;
+}
+
+double rng_n()
+{
+    return current_rng().sequential.n();
+
 }
 
 array<double, 2> cm_bc(string bc, const vector<double>& xi, const vector<double>& yi, double xbox, double ybox, double delrx)
@@ -1,5 +1,5 @@
 /*------------------------------------------------------------------
- motor_ensemble.cpp : container class for motors
+ motor_ensemble.cpp : container class for motors and crosslinkers
 
  Copyright (C) 2016
  Created by: Simon Freedman, Shiladitya Banerjee, Glen Hocky, Aaron Dinner
@@ -14,25 +14,121 @@
 #include "filament_ensemble.h"
 #include "globals.h"
 #include "motor_ensemble.h"
-#include "motor.h"
+#include "potentials.h"
+#include "scheduler.h"
 
 motor_ensemble::motor_ensemble(vector<vector<double>> motors, double delta_t, double temp,
         double mlen, filament_ensemble *network, double v0, double stiffness,
         double ron, double roff, double rend, double fstall, double rcut, double vis)
 {
-    shear_flag = false;
-    static_flag = false;
+    bc = network->get_box();
     f_network = network;
     network->get_box()->add_callback([this](double g) { this->update_d_strain(g); });
+
+    shear_flag = false;
+    static_flag = false;
+
+    // distinguishes random streams of this ensemble from other ensembles
+    rng_tag = new_rng_tag();
+
+    // [parameters]
+    dt = delta_t;
+    temperature = temp;
+    damp = 6 * pi * vis * mlen;
+    bd_prefactor = sqrt(temperature / (2 * damp * dt));
+
+    // attach/detach
+    this->ron = this->ron2 = ron;
+    this->roff = this->roff2 = roff;
+    this->rend = this->rend2 = rend;
+    this->set_binding_interval(dt);
+    max_bind_dist = rcut;
+    max_bind_dist_sq = rcut * rcut;
+    occ = 0.0;
+
+    // walk
+    vs[0] = vs[1] = v0;
+    stall_force[0] = stall_force[1] = fstall;
+
+    // stretch
+    mk = stiffness;
     mld = mlen;
 
-    ext = nullptr;
+    // bend
+    kb = 0.0;  // deactivated
+    th0 = 0.0;
+
+    // align
+    kalign = 0.0;  // deactivated
+    par_flag = 0;
+
+    // external
+    ext = nullptr;  // deactivated
 
     cout << "\nDEBUG: Number of motors:" << motors.size() << "\n";
 
-    for (vector<double> mvec : motors) {
-        n_motors.push_back(new motor(mvec, mlen, f_network, delta_t, temp,
-                    v0, stiffness, ron, roff, rend, fstall, rcut, vis));
+    // [state], [derived], [forces] and [thermo]
+    // forces and thermo are cleared since setup isn't done yet
+    size_t n = motors.size();
+    state.resize(n);
+    h.resize(n);
+    prv_rnd.resize(n);
+    fp_index.resize(n);
+    ldir_bind.resize(n);
+    bind_disp.resize(n);
+    moves.resize(n, {-1, false, vec_type(), {-1, -1}});
+    len.resize(n);
+    disp.resize(n);
+    direc.resize(n);
+    force.resize(n);
+    s_force.resize(n);
+    b_force.resize(n);
+    fil_force.resize(n);
+    ext_force.resize(n);
+    f_proj.resize(n, {0.0, 0.0});
+    s_eng.resize(n, 0.0);
+    b_eng.resize(n, {0.0, 0.0});
+    align_eng.resize(n, 0.0);
+    ext_eng.resize(n, {0.0, 0.0});
+    m_vir_stretch.resize(n);
+    m_vir_bend.resize(n);
+    m_vir_align.resize(n);
+    m_vir_ext.resize(n);
+
+    for (size_t i = 0; i < n; i++) {
+        vector<double> &mvec = motors[i];
+
+        // positions
+        h[i][0] = bc->pos_bc({mvec[0], mvec[1]});
+        h[i][1] = bc->pos_bc({mvec[0] + mvec[2], mvec[1] + mvec[3]});
+
+        // filament and spring indices for each head
+        array<int, 2> f_index = {int(mvec[4]), int(mvec[5])};
+        array<int, 2> l_index = {int(mvec[6]), int(mvec[7])};
+
+        // for bound heads,
+        // set up attachment location with filaments
+        // set detachment location as don't move
+        // assumes that head positions are on filaments
+
+        // for unbound heads,
+        // set in same state as after detachment
+
+        for (int hd = 0; hd < 2; hd++) {
+            if (f_index[hd] == -1 && l_index[hd] == -1) {
+                state[i][hd] = motor_state::free;
+                fp_index[i][hd] = {-1, -1};
+            } else {
+                this->attach_head(i, hd, h[i][hd], {f_index[hd], l_index[hd]});
+            }
+        }
+
+        // set to N(0, 1) to prevent cooling
+        prv_rnd[i][0] = rng_stream(rng_head_init | rng_tag, 2 * i).vec_n();
+        prv_rnd[i][1] = rng_stream(rng_head_init | rng_tag, 2 * i + 1).vec_n();
+
+        // [derived]
+        this->step(i);
     }
 
     this->update_energies();
@@ -41,35 +137,43 @@ motor_ensemble::motor_ensemble(vector<vector<double>> motors, double delta_t, do
 motor_ensemble::~motor_ensemble()
 {
     if (!ext) delete ext;
-    for (motor *m : n_motors) delete m;
 }
 
-void motor_ensemble::add_motor(motor *m)
+int motor_ensemble::get_nmotors()
 {
-    n_motors.push_back(m);
+    return state.size();
 }
 
-int motor_ensemble::get_nmotors()
-{
-    return n_motors.size();
+// begin [settings]
+
+void motor_ensemble::set_binding_two(double ron2, double roff2, double rend2){
+    this->ron2 = ron2;
+    this->roff2 = roff2;
+    this->rend2 = rend2;
+    this->set_binding_interval(binding_interval);
 }
 
-motor *motor_ensemble::get_motor(int i)
+void motor_ensemble::set_binding_interval(double interval)
 {
-    return n_motors[i];
+    binding_interval = interval;
+    kon = ron * interval;
+    koff = roff * interval;
+    kend = rend * interval;
+    kon2 = ron2 * interval;
+    koff2 = roff2 * interval;
+    kend2 = rend2 * interval;
 }
 
-// begin [settings]
-
-void motor_ensemble::set_binding_two(double kon2, double koff2, double kend2){
-    for(unsigned int i = 0; i < n_motors.size(); i++)
-        n_motors[i]->set_binding_two(kon2, koff2, kend2);
+void motor_ensemble::set_dt(double delta_t)
+{
+    dt = delta_t;
+    bd_prefactor = sqrt(temperature / (2 * damp * dt));
+    this->set_binding_interval(dt);
 }
 
 void motor_ensemble::set_bending(double modulus, double ang){
-    double kb  = modulus/mld;
-    for(unsigned int i = 0; i < n_motors.size(); i++)
-        n_motors[i]->set_bending(kb, ang);
+    kb = modulus/mld;
+    th0 = ang;
 }
 
 void motor_ensemble::use_shear(bool flag)
@@ -84,141 +188,773 @@ void motor_ensemble::use_static(bool flag)
 
 void motor_ensemble::set_par(double k)
 {
-    for (motor *m : n_motors)
-        m->set_par(k);
+    kalign = k;
+    par_flag = 1;
 }
 
 void motor_ensemble::set_antipar(double k)
 {
-    for (motor *m : n_motors)
-        m->set_antipar(k);
+    kalign = k;
+    par_flag = -1;
 }
 
 void motor_ensemble::set_align(double k)
 {
-    for (motor *m : n_motors)
-        m->set_align(k);
+    kalign = k;
+    par_flag = 0;
 }
 
 void motor_ensemble::kill_heads(int hd)
 {
-    for (motor *m : n_motors) {
-        m->kill_head(hd);
+    for (size_t i = 0; i < state.size(); i++) {
+        state[i][hd] = motor_state::dead;
     }
 }
 
 void motor_ensemble::unbind_all_heads()
 {
-    for (motor *m : n_motors) {
-        m->detach_head(0, m->generate_off_pos(0));
-        m->detach_head(1, m->generate_off_pos(1));
-        m->deactivate_head(0);
-        m->deactivate_head(1);
+    for (size_t i = 0; i < state.size(); i++) {
+        this->detach_head(i, 0, this->generate_off_pos(i, 0));
+        this->detach_head(i, 1, this->generate_off_pos(i, 1));
+        state[i][0] = motor_state::inactive;
+        state[i][1] = motor_state::inactive;
     }
 }
 
 void motor_ensemble::revive_heads()
 {
-    for (motor *m : n_motors) {
-        m->revive_head(0);
-        m->revive_head(1);
+    for (size_t i = 0; i < state.size(); i++) {
+        state[i][0] = motor_state::free;
+        state[i][1] = motor_state::free;
     }
 }
 
 void motor_ensemble::set_external(external *ext_)
 {
     ext = ext_;
-    for (motor *m : n_motors) {
-        m->set_external(ext);
-    }
 }
 
 void motor_ensemble::set_velocity(double v1, double v2)
 {
-    for (motor *m : n_motors) {
-        m->set_velocity(v1, v2);
-    }
+    vs[0] = v1;
+    vs[1] = v2;
 }
 
 void motor_ensemble::set_stall_force(double f1, double f2)
 {
-    for (motor *m : n_motors) {
-        m->set_stall_force(f1, f2);
+    stall_force[0] = f1;
+    stall_force[1] = f2;
+}
+
+void motor_ensemble::set_occ(double o)
+{
+    occ = o;
+}
+
+// move head in the direction of the other head
+// so that the heads are 'mld' apart
+void motor_ensemble::relax_head(int i, int hd)
+{
+    h[i][hd] = bc->pos_bc(h[i][pr(hd)] - pow(-1, hd)*mld*direc[i]);
+    this->step(i);
+}
+
+// end [settings]
+
+// begin [state]
+
+// return motor state with a given head number
+array<motor_state, 2> motor_ensemble::get_states(int i)
+{
+    return state[i];
+}
+
+vec_type motor_ensemble::get_h0(int i)
+{
+    return h[i][0];
+}
+
+vec_type motor_ensemble::get_h1(int i)
+{
+    return h[i][1];
+}
+
+array<int, 2> motor_ensemble::get_f_index(int i)
+{
+    array<int, 2> fl0 = f_network->get_attached_fl(fp_index[i][0]);
+    array<int, 2> fl1 = f_network->get_attached_fl(fp_index[i][1]);
+    return {fl0[0], fl1[0]};
+}
+
+array<int, 2> motor_ensemble::get_l_index(int i)
+{
+    array<int, 2> fl0 = f_network->get_attached_fl(fp_index[i][0]);
+    array<int, 2> fl1 = f_network->get_attached_fl(fp_index[i][1]);
+    return {fl0[1], fl1[1]};
+}
+
+array<double, 2> motor_ensemble::get_contour_pos(int i)
+{
+    array<double, 2> s = {NAN, NAN};
+    if (state[i][0] == motor_state::bound) s[0] = f_network->get_attached_distance(fp_index[i][0]);
+    if (state[i][1] == motor_state::bound) s[1] = f_network->get_attached_distance(fp_index[i][1]);
+    return s;
+}
+
+// get total force
+array<vec_type, 2> motor_ensemble::get_force(int i)
+{
+    return force[i];
+}
+
+// end [state]
+
+// begin [forces]
+// assume that derived state is computed
+
+// update all forces/energies/virials of motor i
+// forces on filaments are stored in fil_force, and gathered by the filaments
+// (call this ONCE)
+void motor_ensemble::update_force(int i)
+{
+    // bending and alignment forces are added (not assigned)
+    fil_force[i][0].zero();
+    fil_force[i][1].zero();
+
+    // spring forces
+    double tension = mk * (len[i] - mld);
+    vec_type sf = -tension * direc[i];
+    s_force[i][0] = -sf;
+    s_force[i][1] = sf;
+    s_eng[i] = 0.5 * mk * (len[i] - mld) * (len[i] - mld);
+    m_vir_stretch[i] = -0.5 * outer(disp[i], sf);
+
+    // bending forces
+    // partially on filaments
+    if (kb > 0.0) {
+
+        // bending forces are added (not assigned), so clear them first
+        // also, bending forces may not be activated
+        b_eng[i][0] = b_eng[i][1] = 0.0;
+        b_force[i][0].zero();
+        b_force[i][1].zero();
+        m_vir_bend[i].zero();
+
+        // bending forces are activated only when both heads are bound
+        if (state[i][0] == motor_state::bound && state[i][1] == motor_state::bound) {
+            this->update_bending(i, 0);
+            this->update_bending(i, 1);
+        }
+    }
+
+    // alignment forces
+    // all on filaments
+    if (kalign != 0.0) {
+
+        // in case alignment isn't activated
+        align_eng[i] = 0.0;
+        m_vir_align[i].zero();
+
+        // alignment is activated only when both heads are bound
+        if (state[i][0] == motor_state::bound && state[i][1] == motor_state::bound) {
+            this->update_alignment(i);
+        }
+    }
+
+    // external forces
+    if (ext) {
+        m_vir_ext[i].zero();
+        this->update_external(i, 0);
+        this->update_external(i, 1);
+    }
+
+    force[i][0] = s_force[i][0] + b_force[i][0] + ext_force[i][0];
+    force[i][1] = s_force[i][1] + b_force[i][1] + ext_force[i][1];
+
+    // update projected force for walking
+    // computed from other forces, so should be called last
+    if (vs[0] != 0.0) this->update_force_proj(i, 0);
+    if (vs[1] != 0.0) this->update_force_proj(i, 1);
+}
+
+// updates bending forces
+// part of the force is on the spring bound to head hd
+void motor_ensemble::update_bending(int i, int hd)
+{
+    array<int, 2> fl = f_network->get_attached_fl(fp_index[i][hd]);
+    vec_type delr1 = f_network->get_disp(fl[0], fl[1]);
+    vec_type delr2 = pow(-1, hd) * disp[i];
+
+    bend_result_type result = bend_harmonic(kb, th0, delr1, delr2);
+
+    fil_force[i][hd] += result.force1;
+
+    b_force[i][pr(hd)] += result.force2;
+    b_force[i][hd] -= result.force2;
+
+    b_eng[i][hd] += result.energy;
+
+    m_vir_bend[i] += -0.5 * outer(delr1, result.force1);
+    m_vir_bend[i] += -0.5 * outer(delr2, result.force2);
+}
+
+// update forces and energies for alignment
+void motor_ensemble::update_alignment(int i)
+{
+    array<int, 2> fl0 = f_network->get_attached_fl(fp_index[i][0]);
+    vec_type delr0 = f_network->get_disp(fl0[0], fl0[1]);
+
+    array<int, 2> fl1 = f_network->get_attached_fl(fp_index[i][1]);
+    vec_type delr1 = f_network->get_disp(fl1[0], fl1[1]);
+
+    bend_result_type result = bend_angle(delr0, delr1);
+
+    // cosine of angle between vectors
+    // if parallel, 1; if antiparallel, -1
+    double c = result.energy;
+
+    // penalize NOT being parallel/antiparallel by at most kalign
+    double a;
+    if (par_flag == 1) {
+        a = -kalign;
+        align_eng[i] = kalign * (1.0 - c);
+    } else if (par_flag == -1) {
+        a = kalign;
+        align_eng[i] = kalign * (1.0 + c);
+    } else {
+        if (c > 0.0) {
+            a = -kalign;
+            align_eng[i] = kalign * (1.0 - c);
+        } else {
+            a = kalign;
+            align_eng[i] = kalign * (1.0 + c);
+        }
+    }
+
+    vec_type f0 = a * result.force1;
+    vec_type f1 = a * result.force2;
+
+    fil_force[i][0] += f0;
+    fil_force[i][1] += f1;
+
+    m_vir_align[i] += -0.5 * outer(delr0, f0);
+    m_vir_align[i] += -0.5 * outer(delr1, f1);
+}
+
+// update external forces and energies
+void motor_ensemble::update_external(int i, int hd)
+{
+    ext_result_type result = ext->compute(h[i][hd]);
+    ext_eng[i][hd] = result.energy;
+    ext_force[i][hd] = result.force;
+    m_vir_ext[i] += result.virial;
+}
+
+// update projected force for walking
+void motor_ensemble::update_force_proj(int i, int hd)
+{
+    f_proj[i][hd] = 0.0;  // zero if unbound
+    if (state[i][hd] == motor_state::bound && state[i][pr(hd)] != motor_state::free) {
+        vec_type dir = f_network->get_attached_direction(fp_index[i][hd]);
+        f_proj[i][hd] = dot(force[i][hd], dir);
     }
 }
 
-void motor_ensemble::set_occ(double occ)
+array<vec_type, 2> motor_ensemble::get_filament_forces(int i, int hd)
 {
-    for (motor *m : n_motors) {
-        m->set_occ(occ);
+    if (state[i][hd] != motor_state::bound) return {vec_type(), vec_type()};
+    return {force[i][hd], fil_force[i][hd]};
+}
+
+// walking is at most twice vs, see walk
+double motor_ensemble::get_max_drift()
+{
+    double fmax_sq = 0.0;
+    double vmax = 0.0;
+    for (size_t i = 0; i < state.size(); i++) {
+        for (int hd = 0; hd < 2; hd++) {
+            if (state[i][hd] == motor_state::bound) {
+                if (!static_flag) vmax = max(vmax, 2.0 * fabs(vs[hd]));
+            } else {
+                fmax_sq = max(fmax_sq, abs2(force[i][hd]));
+            }
+        }
     }
+    return max(vmax, sqrt(fmax_sq) / damp);
 }
 
-// end [settings]
+double motor_ensemble::get_max_rate()
+{
+    if (state.empty()) return 0.0;
+    return max({ron, roff, rend, ron2, roff2, rend2});
+}
+
+// motors only write their own forces, then each filament
+// gathers the forces of the heads bound to it,
+// so both passes run in parallel without write conflicts
+void motor_ensemble::compute_forces()
+{
+    this->update_head_forces();
+    this->gather_forces();
+}
+
+void motor_ensemble::update_head_forces()
+{
+    this->update_load_cost();
+    balanced_for(load_motor_forces, state.size(), load_cost.data(), [this](int, int first, int last) {
+        for (int i = first; i < last; i++) {
+            this->update_force(i);
+        }
+    });
+}
+
+void motor_ensemble::gather_forces()
+{
+    f_network->gather_attached_forces(this);
+    update_energies();
+}
+
+// bound heads cost more than free ones, and pile up in clusters
+void motor_ensemble::update_load_cost()
+{
+    load_cost.resize(state.size());
+    for (size_t i = 0; i < state.size(); i++) {
+        load_cost[i] = 1.0;
+        if (state[i][0] == motor_state::bound) load_cost[i] += 1.0;
+        if (state[i][1] == motor_state::bound) load_cost[i] += 1.0;
+    }
+}
+
+// end [forces]
 
 // begin [dynamics]
+// assume that forces are calculated
+// does NOT assume that derived state is calculated
+// step should be called after all these are done
+
+// apply shear
+// called automatically by box
+void motor_ensemble::update_d_strain(double g)
+{
+    if (shear_flag) {
+        array<double, 2> fov = bc->get_fov();
+        for (size_t i = 0; i < h.size(); i++) {
+            h[i][0] = bc->pos_bc({h[i][0].x + g * h[i][0].y / fov[1], h[i][0].y});
+            h[i][1] = bc->pos_bc({h[i][1].x + g * h[i][1].y / fov[1], h[i][1].y});
+        }
+    }
+}
+
+// Brownian dynamics for unbound particles
+// does NOT check that particles are unbound
+void motor_ensemble::brownian_relax(int i, int hd)
+{
+    vec_type new_rnd = rng_stream(rng_head_noise | rng_tag, 2 * i + hd).vec_n();
+    vec_type v = force[i][hd] / damp + bd_prefactor * (new_rnd + prv_rnd[i][hd]);
+    h[i][hd] = bc->pos_bc(h[i][hd] + v*dt);
+    prv_rnd[i][hd] = new_rnd;
+}
+
+// stepping kinetics of a single bound head
+void motor_ensemble::walk(int i, int hd)
+{
+    if (vs[hd] == 0.0) return;
+    if (vs[hd] > 0.0 && f_network->at_barbed_end(fp_index[i][hd])) return;
+    if (vs[hd] < 0.0 && f_network->at_pointed_end(fp_index[i][hd])) return;
+
+    //calculate motor velocity
+    double vm = vs[hd];
+    if (state[i][pr(hd)] != motor_state::free) {
+        double factor = 1.0 - f_proj[i][hd] / stall_force[hd];
+        if (factor < 0.0) factor = 0.0;
+        if (factor > 2.0) factor = 2.0;
+        vm = factor * vs[hd];
+    }
+
+    // update relative position
+    f_network->add_attached_pos(fp_index[i][hd], vm * dt);
+}
+
+// update positions from filaments if needed,
+// and compute 'disp', 'len', and 'direc' based on positions
+void motor_ensemble::step(int i)
+{
+    if (state[i][0] == motor_state::bound) h[i][0] = f_network->get_attached_pos(fp_index[i][0]);
+    if (state[i][1] == motor_state::bound) h[i][1] = f_network->get_attached_pos(fp_index[i][1]);
+    disp[i] = bc->rij_bc(h[i][1] - h[i][0]);
+    len[i] = abs(disp[i]);
+    direc[i].zero();
+    if (len[i] != 0) direc[i] = disp[i] / len[i];
+}
+
+void motor_ensemble::integrate()
+{
+    this->integrate_free();
+    this->integrate_bound();
+}
+
+// free heads don't depend on filaments or on the other head
+void motor_ensemble::integrate_free()
+{
+    for (size_t i = 0; i < state.size(); i++) {
+        array<motor_state, 2> s = state[i];
+        if (s[0] == motor_state::free || s[0] == motor_state::inactive) {
+            this->brownian_relax(i, 0);
+        }
+        if (s[1] == motor_state::free || s[1] == motor_state::inactive) {
+            this->brownian_relax(i, 1);
+        }
+    }
+}
+
+void motor_ensemble::integrate_bound()
+{
+    for (size_t i = 0; i < state.size(); i++) {
+        array<motor_state, 2> s = state[i];
+        if (!static_flag && s[0] == motor_state::bound) {
+            this->walk(i, 0);
+        }
+        if (!static_flag && s[1] == motor_state::bound) {
+            this->walk(i, 1);
+        }
+        this->step(i);
+    }
+}
+
+// end [dynamics]
+
+// begin [attach/detach]
+// assumes that derived state is computed
+// if positions are changed, derived states are recomputed
 
 void motor_ensemble::try_attach_detach()
 {
-    for (size_t i = 0; i < n_motors.size(); i++) {
-        this->try_attach_detach(i);
+    this->propose_attach_detach();
+    for (size_t i = 0; i < state.size(); i++) {
+        if (moves[i].hd != -1) this->commit_attach_detach(i);
     }
 }
 
 void motor_ensemble::try_attach_detach(int i)
 {
-    array<motor_state, 2> s = n_motors[i]->get_states();
+    this->propose_attach_detach(i);
+    if (moves[i].hd != -1) this->commit_attach_detach(i);
+}
 
-    mc_prob p;
+// proposing only reads filaments, and motors don't depend on each other,
+// so moves are proposed in parallel
+void motor_ensemble::propose_attach_detach()
+{
+    bool failed = false;
+    string what;
+
+    this->update_load_cost();
+    balanced_for(load_attach_detach, state.size(), load_cost.data(), [&](int, int first, int last) {
+        for (int i = first; i < last; i++) {
+            try {
+                this->propose_attach_detach(i);
+            } catch (exception &e) {
+                // exceptions can't leave a parallel region
+                #pragma omp critical
+                {
+                    failed = true;
+                    what = e.what();
+                }
+            }
+        }
+    });
+
+    if (failed) throw runtime_error(what);
+}
+
+// a motor attempts at most one move per step,
+// since all its attempts share one random number
+void motor_ensemble::propose_attach_detach(int i)
+{
+    array<motor_state, 2> s = state[i];
+    moves[i].hd = -1;
+
+    mc_prob p(rng_stream(rng_attach_detach | rng_tag, i).u());
 
     if (s[0] == motor_state::free) {
-        n_motors[i]->try_attach(0, p);
+        if (this->try_attach(i, 0, p)) return;
     } else if (s[0] != motor_state::inactive) {
-        n_motors[i]->try_detach(0, p);
+        if (this->try_detach(i, 0, p)) return;
     }
 
     if (s[1] == motor_state::free) {
-        n_motors[i]->try_attach(1, p);
+        this->try_attach(i, 1, p);
     } else if (s[1] != motor_state::inactive) {
-        n_motors[i]->try_detach(1, p);
+        this->try_detach(i, 1, p);
     }
 }
 
-void motor_ensemble::integrate()
+bool motor_ensemble::has_move(int i)
 {
-    for (motor *m : n_motors) {
-        array<motor_state, 2> s = m->get_states();
-        if (s[0] == motor_state::free || s[0] == motor_state::inactive) {
-            m->brownian_relax(0);
-        } else if (!static_flag && s[0] == motor_state::bound) {
-            m->walk(0);
+    return moves[i].hd != -1;
+}
+
+// applies the move proposed for motor i
+void motor_ensemble::commit_attach_detach(int i)
+{
+    motor_move &m = moves[i];
+    int hd = m.hd;
+    m.hd = -1;
+
+    if (!m.attach) {
+        detach_head(i, hd, m.pos);
+        return;
+    }
+
+    // don't bind if there is a head bound closer than occ
+    // this depends on the moves committed before, so it's checked here
+    filament *f = f_network->get_filament(m.fl[0]);
+    if (occ != 0.0 && f->closest_attached_distance(m.fl[1], m.pos) < occ) return;
+
+    attach_head(i, hd, m.pos, m.fl);
+}
+
+// metropolis algorithm
+// compute attachment/detachment probability between current and proposed state
+// probability is in range [0, 1]
+double motor_ensemble::metropolis_prob(int i, int hd, array<int, 2> fl_idx, vec_type newpos)
+{
+    // stretching
+    double len_old = bc->dist_bc(h[i][hd] - h[i][pr(hd)]) - mld;
+    double len_new = bc->dist_bc(newpos - h[i][pr(hd)]) - mld;
+    double dE = 0.5 * mk * (len_new * len_new - len_old * len_old);
+
+    // bending
+    if (kb > 0.0 && state[i][pr(hd)] == motor_state::bound) {
+        array<int, 2> fl;
+        vec_type delr1, delr2;
+        if (state[i][hd] == motor_state::free) {
+            // attach: singly bound -> doubly bound
+
+            // new bending energy of attaching head
+            fl = fl_idx;
+            delr1 = f_network->get_disp(fl[0], fl[1]);
+            delr2 = pow(-1, hd) * disp[i];
+            dE += bend_harmonic_energy(kb, th0, delr1, delr2);
+
+            // new bending energy of other head
+            fl = f_network->get_attached_fl(fp_index[i][pr(hd)]);
+            delr1 = f_network->get_disp(fl[0], fl[1]);
+            delr2 = pow(-1, pr(hd)) * disp[i];
+            dE += bend_harmonic_energy(kb, th0, delr1, delr2);
+
         }
-        if (s[1] == motor_state::free || s[1] == motor_state::inactive) {
-            m->brownian_relax(1);
-        } else if (!static_flag && s[1] == motor_state::bound) {
-            m->walk(1);
+        if (state[i][hd] == motor_state::bound) {
+            // detach: doubly bound -> singly bound
+
+            // old bending energy of detaching head
+            fl = f_network->get_attached_fl(fp_index[i][hd]);
+            delr1 = f_network->get_disp(fl[0], fl[1]);
+            delr2 = pow(-1, hd) * disp[i];
+            dE -= bend_harmonic_energy(kb, th0, delr1, delr2);
+
+            // old bending energy of other head
+            fl = f_network->get_attached_fl(fp_index[i][pr(hd)]);
+            delr1 = f_network->get_disp(fl[0], fl[1]);
+            delr2 = pow(-1, pr(hd)) * disp[i];
+            dE -= bend_harmonic_energy(kb, th0, delr1, delr2);
+
+        }
+    }
+
+    // alignment
+    if (kalign != 0.0 && state[i][pr(hd)] == motor_state::bound) {
+        array<int, 2> fl;
+        if (state[i][hd] == motor_state::free) {
+            // attach: singly bound -> doubly bound
+
+            // spring to be attached
+            fl = fl_idx;
+            vec_type delr1 = f_network->get_disp(fl[0], fl[1]);
+
+            // other attached spring
+            fl = f_network->get_attached_fl(fp_index[i][pr(hd)]);
+            vec_type delr2 = f_network->get_disp(fl[0], fl[1]);
+
+            dE += alignment_penalty(delr1, delr2);
         }
-        m->step();
+        if (state[i][hd] == motor_state::bound) {
+            // detach: doubly bound -> singly bound
+
+            // spring to be detached
+            fl = f_network->get_attached_fl(fp_index[i][hd]);
+            vec_type delr1 = f_network->get_disp(fl[0], fl[1]);
+
+            // other attached spring
+            fl = f_network->get_attached_fl(fp_index[i][pr(hd)]);
+            vec_type delr2 = f_network->get_disp(fl[0], fl[1]);
+
+            dE -= alignment_penalty(delr1, delr2);
+        }
+    }
+
+    // external
+    if (ext) {
+        dE += ext->compute(newpos).energy - ext->compute(h[i][hd]).energy;
     }
+
+    return (dE <= 0.0) ? 1.0 : exp(-dE / temperature);
 }
 
-void motor_ensemble::update_d_strain(double g)
+// compute the alignment penalty for doubly bound heads
+// values are in range [0, kalign], where
+// 0 is for parallel/antiparallel and kalign is for antiparallel/parallel
+double motor_ensemble::alignment_penalty(vec_type delr1, vec_type delr2)
 {
-    if (shear_flag) {
-        for (motor *m : n_motors) {
-            m->update_d_strain(g);
+    // cosine of angle between vectors
+    // if parallel, 1; if antiparallel, -1
+    double c = angle(delr1, delr2);
+
+    // penalize NOT being parallel/antiparallel by at most kalign
+    if (par_flag == 1) {
+        return kalign * (1.0 - c);
+    } else if (par_flag == -1) {
+        return kalign * (1.0 + c);
+    } else {
+        if (c > 0.0) {
+            return kalign * (1.0 - c);
+        } else {
+            return kalign * (1.0 + c);
         }
     }
 }
 
-void motor_ensemble::compute_forces()
+// ATTACHMENT
+
+// attempt to attach unbound head to a filament
+// does NOT check that the head in unbound
+// if accepted, records the attachment in moves and returns true
+//check for attachment of unbound heads given head index (0 for head 1, and 1 for head 2)
+bool motor_ensemble::try_attach(int i, int hd, mc_prob &p)
 {
-    for (motor *m : n_motors) {
-        m->update_force();
+    double onrate = (state[i][pr(hd)] == motor_state::bound) ? kon2 : kon;
+    vector<array<int, 2>> *attach_list = f_network->get_attach_list(h[i][hd]);
+
+    int count = attach_list->size();
+    double needprob = onrate * count;
+    boost::optional<double> opt_p = p(needprob);
+
+    if (opt_p) {
+        double mf_rand = *opt_p;
+        int j = floor(mf_rand / onrate);
+        double remprob = mf_rand - onrate * j;
+
+        if (j < 0) throw std::logic_error("attach list index < 0");
+        if (j >= count) throw std::logic_error("attach list index >= count");
+        if (remprob < 0 || remprob > onrate) throw std::logic_error("invalid remaining probability");
+
+        // compute and get attachment point
+        array<int, 2> fl = attach_list->at(j);
+        vec_type intpoint = f_network->get_intpoint(fl[0], fl[1], h[i][hd]);
+
+        // don't bind if binding site is further away than the cutoff
+        vec_type dr = bc->rij_bc(intpoint - h[i][hd]);
+        double dist_sq = abs2(dr);
+        if (dist_sq > max_bind_dist_sq || !allowed_bind(i, hd, fl)) {
+            return false;
+        }
+
+        double prob = onrate * metropolis_prob(i, hd, fl, intpoint);
+
+        if (remprob < prob) {
+            // occlusion is checked by commit_attach_detach
+            moves[i] = {hd, true, intpoint, fl};
+            return true;
+        }
     }
-    update_energies();
+
+    return false;
+}
+
+bool motor_ensemble::allowed_bind(int i, int hd, array<int, 2> fl_idx){
+    array<int, 2> fl = f_network->get_attached_fl(fp_index[i][pr(hd)]);
+    if (kb > 0.0) return fl_idx[0] != fl[0];
+    return fl[0] != fl_idx[0] || fl[1] != fl_idx[1];
+}
+
+// attaches head to spring {f, l} at intpoint
+// saves information for detachment
+// assumes that intpoint is on the spring
+void motor_ensemble::attach_head(int i, int hd, vec_type intpoint, array<int, 2> fl)
+{
+    // update state
+    state[i][hd] = motor_state::bound;
+    fp_index[i][hd] = f_network->new_attached(this, i, hd, fl[0], fl[1], intpoint);
+
+    // record displacement of head and orientation of spring for future unbinding move
+    ldir_bind[i][hd] = f_network->get_attached_direction(fp_index[i][hd]);
+    bind_disp[i][hd] = bc->rij_bc(intpoint - h[i][hd]);
+
+    // update head position
+    h[i][hd] = intpoint;
+    this->step(i);
+}
+
+// DETACHMENT
+
+// attempts to detach hd with maximum rate offrate
+// the detachment position is determined by generate_off_pos
+// returns true and records the detachment in moves if it succeeds, and false otherwise
+// assumes that the head is bound
+bool motor_ensemble::try_detach(int i, int hd, mc_prob &p)
+{
+    vec_type hpos_new = generate_off_pos(i, hd);
+    double offrate = f_network->at_barbed_end(fp_index[i][hd]) ? kend : koff;
+    if (state[i][pr(hd)] == motor_state::bound)
+        offrate = f_network->at_barbed_end(fp_index[i][hd]) ? kend2 : koff2;
+
+    boost::optional<double> opt_p = p(offrate);
+    if (opt_p) {
+        double prob = offrate * metropolis_prob(i, hd, {-1, -1}, hpos_new);
+        if (*opt_p < prob) {
+            moves[i] = {hd, false, hpos_new, {-1, -1}};
+            return true;
+        }
+    }
+    return false;
 }
 
+// compute unbinding position
+// head must be bound
+vec_type motor_ensemble::generate_off_pos(int i, int hd)
+{
+    vec_type ldir = f_network->get_attached_direction(fp_index[i][hd]);
+    double c = dot(ldir, ldir_bind[i][hd]);
+    double s = cross(ldir, ldir_bind[i][hd]);
+
+    vec_type bd = bind_disp[i][hd];
+    vec_type bind_disp_rot = {bd.x*c - bd.y*s, bd.x*s + bd.y*c};
+
+    return bc->pos_bc(h[i][hd] - bind_disp_rot);
+}
+
+// detach head, and leave it at the same position
+void motor_ensemble::detach_head_without_moving(int i, int hd)
+{
+    state[i][hd] = motor_state::free;
+    f_network->del_attached(fp_index[i][hd]);
+    fp_index[i][hd] = {-1, -1};
+    ldir_bind[i][hd].zero();
+    bind_disp[i][hd].zero();
+}
+
+// detach head, and move it to the specified position
+void motor_ensemble::detach_head(int i, int hd, vec_type newpos)
+{
+    detach_head_without_moving(i, hd);
+    h[i][hd] = newpos;
+    this->step(i);
+}
+
+// end [attach/detach]
+
+// begin [thermo]
+
 void motor_ensemble::update_energies()
 {
     pe_stretch = 0.0;
@@ -231,25 +967,20 @@ void motor_ensemble::update_energies()
     vir_align.zero();
     vir_ext.zero();
 
-    for (motor *m : n_motors) {
-        pe_stretch += m->get_stretching_energy();
-        array<double, 2> m_pe_bend = m->get_bending_energy();
-        pe_bend += m_pe_bend[0] + m_pe_bend[1];
-        pe_align += m->get_alignment_energy();
-        array<double, 2> m_pe_ext = m->get_external_energy();
-        pe_ext += m_pe_ext[0] + m_pe_ext[1];
-
-        vir_stretch += m->get_stretching_virial();
-        vir_bend += m->get_bending_virial();
-        vir_align += m->get_alignment_virial();
-        vir_ext += m->get_external_virial();
+    size_t n = state.size();
+    for (size_t i = 0; i < n; i++) {
+        pe_stretch += s_eng[i];
+        pe_bend += b_eng[i][0] + b_eng[i][1];
+        pe_align += align_eng[i];
+        pe_ext += ext_eng[i][0] + ext_eng[i][1];
+
+        vir_stretch += m_vir_stretch[i];
+        vir_bend += m_vir_bend[i];
+        vir_align += m_vir_align[i];
+        vir_ext += m_vir_ext[i];
     }
 }
 
-// end [dynamics]
-
-// begin [thermo]
-
 // energy
 
 double motor_ensemble::get_potential_energy()
@@ -308,9 +1039,29 @@ virial_type motor_ensemble::get_external_virial()
 
 // begin [output]
 
-void motor_ensemble::print_ensemble_thermo()
+vector<double> motor_ensemble::output(int i)
 {
-    fmt::print(
+    array<int, 2> fl0 = f_network->get_attached_fl(fp_index[i][0]);
+    array<int, 2> fl1 = f_network->get_attached_fl(fp_index[i][1]);
+    return {h[i][0].x, h[i][0].y, disp[i].x, disp[i].y,
+        double(fl0[0]), double(fl1[0]),
+        double(fl0[1]), double(fl1[1])};
+}
+
+string motor_ensemble::write(int i)
+{
+    array<int, 2> fl0 = f_network->get_attached_fl(fp_index[i][0]);
+    array<int, 2> fl1 = f_network->get_attached_fl(fp_index[i][1]);
+    return fmt::format("\n{}\t{}\t{}\t{}\t{}\t{}\t{}\t{}",
+            h[i][0].x, h[i][0].y,
+            disp[i].x, disp[i].y,
+            fl0[0], fl1[0],
+            fl0[1], fl1[1]);
+}
+
+void motor_ensemble::print_ensemble_thermo(ostream &out)
+{
+    fmt::print(out,
             "\n"
             "All Motors\t:\t"
             "PEs = {}\t"
@@ -325,27 +1076,39 @@ void motor_ensemble::print_ensemble_thermo()
 vector<vector<double>> motor_ensemble::output()
 {
     vector<vector<double>> out;
-    for (motor *m : n_motors) {
-        out.push_back(m->output());
+    for (size_t i = 0; i < state.size(); i++) {
+        out.push_back(this->output(i));
     }
     return out;
 }
 
 void motor_ensemble::motor_write(ostream& fout)
 {
-    for (motor *m : n_motors) {
-        fout << m->write();
+    for (size_t i = 0; i < state.size(); i++) {
+        fout << this->write(i);
     }
 }
 
 void motor_ensemble::motor_write_doubly_bound(ostream& fout)
 {
     array<motor_state, 2> doubly_bound = {motor_state::bound, motor_state::bound};
-    for (size_t i = 0; i < n_motors.size(); i++) {
-        if (n_motors[i]->get_states() == doubly_bound) {
-            fmt::print(fout, "{}\t{}", n_motors[i]->write(), i);
+    for (size_t i = 0; i < state.size(); i++) {
+        if (state[i] == doubly_bound) {
+            fmt::print(fout, "{}\t{}", this->write(i), i);
         }
     }
 }
 
+void motor_ensemble::copy_output(vector<double> &out)
+{
+    out.clear();
+    for (size_t i = 0; i < state.size(); i++) {
+        array<int, 2> fl0 = f_network->get_attached_fl(fp_index[i][0]);
+        array<int, 2> fl1 = f_network->get_attached_fl(fp_index[i][1]);
+        out.insert(out.end(), {h[i][0].x, h[i][0].y, disp[i].x, disp[i].y,
+                double(fl0[0]), double(fl1[0]),
+                double(fl0[1]), double(fl1[1])});
+    }
+}
+
 // end [output]
@@ -5,11 +5,16 @@ quadrants::quadrants(box *bc_, array<int, 2> nq_)
     bc = bc_;
     nq = nq_;
     quad_flag = true;
+    pad = 0.0;
+    pairs_dirty = true;
+    nsprings = 0;
+    update_count = 0;
 
     quads = new vector<array<int, 2>> *[nq[0]];
     quads[0] = new vector<array<int, 2>>[nq[0] * nq[1]];
     for (int x = 0; x < nq[0]; x++)
         quads[x] = quads[0] + x * nq[1];
+    cell_springs.resize(nq[0] * nq[1]);
 }
 
 quadrants::~quadrants()
@@ -23,45 +28,275 @@ void quadrants::use_quad(bool flag)
     quad_flag = flag;
 }
 
-void quadrants::add_spring(spring *s, array<int, 2> fl)
+void quadrants::set_skin(double skin)
+{
+    pad = 0.5 * skin;
+}
+
+void quadrants::add_spring(vec_type h0, vec_type h1, vec_type disp, array<int, 2> fl)
 {
     if (!quad_flag)
         all_springs.push_back(fl);
-    if (bc->get_BC() == bc_type::periodic || bc->get_BC() == bc_type::lees_edwards)
-        add_spring_periodic(s, fl);
-    else
-        add_spring_nonperiodic(s, fl);
+
+    // springs are numbered in the order they are added
+    int id = nsprings++;
+    if (id >= int(spring_fl.size())) {
+        spring_fl.resize(id + 1, {-1, -1});
+        spring_range.resize(id + 1);
+        spring_cells.resize(id + 1);
+        spring_seen.resize(id + 1, -1);
+    }
+    array<double, 4> b = this->find_bounds(h0, h1, disp);
+    spring_fl[id] = fl;
+    spring_range[id] = this->find_range(b);
+    this->find_cells(b, spring_range[id], spring_cells[id]);
+    this->insert(id);
+    pairs_dirty = true;
+}
+
+// springs are binned in parallel, then merged into the quadrants by a counting sort
+// thread t handles the t-th contiguous block of springs, and its entries
+// go after those of threads < t, so each quadrant lists its springs in order
+void quadrants::add_springs(const vector<array<int, 2>> &fl, const vector<int> &index,
+        const vec_type *pos, const vec_type *disp)
+{
+    if (!quad_flag)
+        all_springs.insert(all_springs.end(), fl.begin(), fl.end());
+
+    int first = nsprings;
+    int n = fl.size();
+    nsprings += n;
+    if (nsprings > int(spring_fl.size())) {
+        spring_fl.resize(nsprings, {-1, -1});
+        spring_range.resize(nsprings);
+        spring_cells.resize(nsprings);
+        spring_seen.resize(nsprings, -1);
+    }
+
+    int ncells = nq[0] * nq[1];
+    cell_counts.assign(size_t(get_max_threads()) * ncells, 0);
+    int nt = 1;
+
+    #pragma omp parallel
+    {
+        #pragma omp single
+        nt = get_num_threads();
+
+        int t = get_thread_num();
+        int *count = &cell_counts[size_t(t) * ncells];
+        int id0 = first + int((long(n) * t) / nt);
+        int id1 = first + int((long(n) * (t + 1)) / nt);
+
+        for (int id = id0; id < id1; id++) {
+            int s = index[id - first];
+            array<double, 4> b = this->find_bounds(pos[s], pos[s + 1], disp[s]);
+            spring_fl[id] = fl[id - first];
+            spring_range[id] = this->find_range(b);
+            spring_cells[id].clear();
+            this->find_cells(b, spring_range[id], spring_cells[id]);
+            for (int cell : spring_cells[id])
+                count[cell]++;
+        }
+
+        // turn the counts into each thread's first slot in each quadrant
+        #pragma omp barrier
+        #pragma omp for
+        for (int cell = 0; cell < ncells; cell++) {
+            int k = cell_springs[cell].size();
+            for (int u = 0; u < nt; u++) {
+                int c = cell_counts[size_t(u) * ncells + cell];
+                cell_counts[size_t(u) * ncells + cell] = k;
+                k += c;
+            }
+            cell_springs[cell].resize(k);
+            quads[0][cell].resize(k);
+        }
+
+        for (int id = id0; id < id1; id++) {
+            for (int cell : spring_cells[id]) {
+                int k = count[cell]++;
+                cell_springs[cell][k] = id;
+                quads[0][cell][k] = spring_fl[id];
+            }
+        }
+    }
+    pairs_dirty = true;
+}
+
+void quadrants::begin_update()
+{
+    update_count++;
+}
+
+void quadrants::update_spring(int id, vec_type h0, vec_type h1, vec_type disp, array<int, 2> fl)
+{
+    if (id >= int(spring_fl.size())) {
+        spring_fl.resize(id + 1, {-1, -1});
+        spring_range.resize(id + 1);
+        spring_cells.resize(id + 1);
+        spring_seen.resize(id + 1, -1);
+    }
+    spring_seen[id] = update_count;
+
+    array<double, 4> b = this->find_bounds(h0, h1, disp);
+    array<int, 4> r = this->find_range(b);
+
+    if (spring_fl[id][0] >= 0 && r == spring_range[id] && this->range_is_exact(r)) {
+        // still in the same quadrants
+        if (spring_fl[id] != fl) {
+            // renumbered by a fracture
+            this->relabel(id, fl);
+            pairs_dirty = true;
+        }
+        return;
+    }
+
+    scratch_cells.clear();
+    this->find_cells(b, r, scratch_cells);
+    spring_range[id] = r;
+
+    if (spring_fl[id][0] < 0) {
+        spring_fl[id] = fl;
+        spring_cells[id].swap(scratch_cells);
+        this->insert(id);
+        pairs_dirty = true;
+    } else if (scratch_cells != spring_cells[id]) {
+        this->erase(id);
+        spring_fl[id] = fl;
+        spring_cells[id].swap(scratch_cells);
+        this->insert(id);
+        pairs_dirty = true;
+    } else if (spring_fl[id] != fl) {
+        this->relabel(id, fl);
+        pairs_dirty = true;
+    }
+}
+
+void quadrants::remove_spring(int id)
+{
+    if (id >= int(spring_fl.size()) || spring_fl[id][0] < 0) return;
+    this->erase(id);
+    spring_fl[id] = {-1, -1};
+    spring_cells[id].clear();
+    pairs_dirty = true;
+}
+
+void quadrants::end_update()
+{
+    for (int id = 0; id < int(spring_fl.size()); id++) {
+        if (spring_fl[id][0] >= 0 && spring_seen[id] != update_count)
+            this->remove_spring(id);
+    }
+}
+
+void quadrants::insert(int id)
+{
+    for (int cell : spring_cells[id]) {
+        quads[0][cell].push_back(spring_fl[id]);
+        cell_springs[cell].push_back(id);
+    }
+}
+
+// a spring can cover a quadrant twice if it wraps around the box,
+// so each listed quadrant removes one entry
+void quadrants::erase(int id)
+{
+    for (int cell : spring_cells[id]) {
+        vector<int> &ids = cell_springs[cell];
+        vector<array<int, 2>> &quad = quads[0][cell];
+        size_t k = find(ids.begin(), ids.end(), id) - ids.begin();
+        if (k == ids.size()) throw std::logic_error("spring missing from its quadrant");
+        ids[k] = ids.back();
+        ids.pop_back();
+        quad[k] = quad.back();
+        quad.pop_back();
+    }
 }
 
+void quadrants::relabel(int id, array<int, 2> fl)
+{
+    spring_fl[id] = fl;
+    for (int cell : spring_cells[id]) {
+        vector<int> &ids = cell_springs[cell];
+        for (size_t k = 0; k < ids.size(); k++)
+            if (ids[k] == id) quads[0][cell][k] = fl;
+    }
+}
+
+// spring a and then its partners b > a are walked in order,
+// so pairs come out sorted by id without a global sort
+// blocks of springs are handled in parallel and concatenated in order,
+// which gives the same pairs for any number of threads
 void quadrants::build_pairs()
 {
-    pairs.clear();
     if (!quad_flag) {
+        pairs.clear();
         for (size_t i = 0; i < all_springs.size(); i++) {
-            for (size_t j = i + 1; i < all_springs.size(); i++) {
+            for (size_t j = i + 1; j < all_springs.size(); j++) {
                 pairs.push_back({all_springs[i], all_springs[j]});
             }
         }
 
-    } else {
-        for (int ix = 0; ix < nq[0]; ix++) {
-            for (int iy = 0; iy < nq[1]; iy++) {
-                vector<array<int, 2>> &q = quads[ix][iy];
-                for (size_t i = 0; i < q.size(); i++) {
-                    for (size_t j = i + 1; j < q.size(); j++) {
-                        // insertion order is preserved in each quadrant,
-                        // so we don't risk double counting
-                        pairset.insert({q[i], q[j]});
+    } else if (pairs_dirty) {
+        int n = spring_fl.size();
+        int nblocks = (get_max_threads() > 1) ? 16 * get_max_threads() : 1;
+        pair_blocks.resize(nblocks);
+
+        #pragma omp parallel
+        {
+            vector<int> partners;
+
+            #pragma omp for schedule(dynamic)
+            for (int blk = 0; blk < nblocks; blk++) {
+                vector<array<array<int, 2>, 2>> &out = pair_blocks[blk];
+                out.clear();
+                int a1 = int((long(n) * (blk + 1)) / nblocks);
+                for (int a = int((long(n) * blk) / nblocks); a < a1; a++) {
+                    if (spring_fl[a][0] < 0) continue;
+                    partners.clear();
+                    for (int cell : spring_cells[a]) {
+                        for (int b : cell_springs[cell]) {
+                            if (b > a && this->owns_pair(a, b, cell))
+                                partners.push_back(b);
+                        }
                     }
+                    // partners from different quadrants interleave,
+                    // and a spring can wrap into the same quadrant twice
+                    sort(partners.begin(), partners.end());
+                    partners.erase(unique(partners.begin(), partners.end()), partners.end());
+                    for (int b : partners)
+                        out.push_back({spring_fl[a], spring_fl[b]});
                 }
             }
         }
-        pairs.assign(begin(pairset), end(pairset));
-        pairset.clear();
+
+        if (nblocks == 1) {
+            pairs.swap(pair_blocks[0]);
+        } else {
+            vector<size_t> start(nblocks + 1, 0);
+            for (int blk = 0; blk < nblocks; blk++)
+                start[blk + 1] = start[blk] + pair_blocks[blk].size();
+            pairs.resize(start[nblocks]);
+
+            #pragma omp parallel for
+            for (int blk = 0; blk < nblocks; blk++)
+                copy(pair_blocks[blk].begin(), pair_blocks[blk].end(), pairs.begin() + start[blk]);
+        }
+        pairs_dirty = false;
 
     }
 }
 
+bool quadrants::owns_pair(int a, int b, int cell)
+{
+    for (int c : spring_cells[a]) {
+        if (c == cell) return true;
+        for (int d : spring_cells[b])
+            if (d == c) return false;
+    }
+    return true;
+}
+
 vector<array<array<int, 2>, 2>> *quadrants::get_pairs()
 {
     return &pairs;
@@ -101,6 +336,15 @@ void quadrants::clear()
     for (int x = 0; x < nq[0]; x++)
         for (int y = 0; y < nq[1]; y++)
             quads[x][y].clear();
+    for (vector<int> &c : cell_springs)
+        c.clear();
+    // keep the per-spring storage, to reuse it on the next build
+    for (size_t id = 0; id < spring_fl.size(); id++) {
+        spring_fl[id] = {-1, -1};
+        spring_cells[id].clear();
+    }
+    nsprings = 0;
+    pairs_dirty = true;
 }
 
 void quadrants::check_duplicates()
@@ -126,21 +370,90 @@ void quadrants::check_duplicates()
     }
 }
 
-void quadrants::add_spring_nonperiodic(spring *s, array<int, 2> fl)
+// bounding box {xlo, xhi, ylo, yhi} of a spring, padded by the skin
+// under periodic boundaries it starts from the lower end and may extend out of the box
+array<double, 4> quadrants::find_bounds(vec_type h0, vec_type h1, vec_type disp)
+{
+    array<double, 2> fov = bc->get_fov();
+    double xlo, xhi;
+    double ylo, yhi;
+
+    if (bc->get_BC() == bc_type::periodic || bc->get_BC() == bc_type::lees_edwards) {
+        array<double, 2> hx = {h0.x, h1.x};
+        array<double, 2> hy = {h0.y, h1.y};
+        if (disp.y >= 0) {
+            ylo = hy[0];
+            yhi = hy[0] + disp.y;
+            if (disp.x >= 0) {
+                xlo = hx[0];
+                xhi = hx[0] + disp.x;
+            } else {
+                xlo = hx[0] + disp.x;
+                xhi = hx[0];
+            }
+        } else {
+            ylo = hy[1];
+            yhi = hy[1] - disp.y;
+            if (disp.x >= 0) {
+                xlo = hx[1] - disp.x;
+                xhi = hx[1];
+            } else {
+                xlo = hx[1];
+                xhi = hx[1] - disp.x;
+            }
+        }
+        if (xlo > xhi) throw std::logic_error("xlo > xhi");
+        if (ylo > yhi) throw std::logic_error("ylo > yhi");
+        xlo -= pad;
+        xhi += pad;
+        ylo -= pad;
+        yhi += pad;
+
+    } else {
+        xlo = h0.x, xhi = h1.x;
+        if (disp.x < 0) std::swap(xlo, xhi);
+
+        ylo = h0.y, yhi = h1.y;
+        if (disp.y < 0) std::swap(ylo, yhi);
+
+        // the padding alone shouldn't push a spring out of the box
+        xlo = max(xlo - pad, min(xlo, -0.5 * fov[0]));
+        xhi = min(xhi + pad, max(xhi, 0.5 * fov[0]));
+        ylo = max(ylo - pad, min(ylo, -0.5 * fov[1]));
+        yhi = min(yhi + pad, max(yhi, 0.5 * fov[1]));
+    }
+    return {xlo, xhi, ylo, yhi};
+}
+
+// quadrant range {xlower, xupper, ylower, yupper} of a bounding box, before wrapping
+array<int, 4> quadrants::find_range(const array<double, 4> &b)
 {
     array<double, 2> fov = bc->get_fov();
-    vec_type h0 = s->get_h0();
-    vec_type h1 = s->get_h1();
-    vec_type disp = s->get_disp();
+    return {
+        int(floor(nq[0] * (b[0] / fov[0] + 0.5))),
+        int( ceil(nq[0] * (b[1] / fov[0] + 0.5))),
+        int(floor(nq[1] * (b[2] / fov[1] + 0.5))),
+        int( ceil(nq[1] * (b[3] / fov[1] + 0.5)))};
+}
 
-    double xlo = h0.x, xhi = h1.x;
-    if (disp.x < 0) std::swap(xlo, xhi);
+// the quadrants of a spring only depend on its range,
+// unless it wraps around y and the wrapped part is shifted in x
+bool quadrants::range_is_exact(const array<int, 4> &r)
+{
+    return bc->get_delrx() == 0.0 || (r[2] >= 0 && r[3] < nq[1]);
+}
 
-    double ylo = h0.y, yhi = h1.y;
-    if (disp.y < 0) std::swap(ylo, yhi);
+void quadrants::find_cells(const array<double, 4> &b, const array<int, 4> &r, vector<int> &cells)
+{
+    if (bc->get_BC() == bc_type::periodic || bc->get_BC() == bc_type::lees_edwards)
+        this->find_cells_periodic(b, r, cells);
+    else
+        this->find_cells_nonperiodic(r, cells);
+}
 
-    int xlower = floor(nq[0] * (xlo / fov[0] + 0.5));
-    int xupper = ceil(nq[0] * (xhi / fov[0] + 0.5));
+void quadrants::find_cells_nonperiodic(array<int, 4> r, vector<int> &cells)
+{
+    int xlower = r[0], xupper = r[1];
     if (xlower < 0) {
         cout << "Warning: x-index of quadrant < 0." << endl;
         xlower = 0;
@@ -151,8 +464,7 @@ void quadrants::add_spring_nonperiodic(spring *s, array<int, 2> fl)
     }
     if (xlower > xupper) throw std::logic_error("xlower > xupper");
 
-    int ylower = floor(nq[1] * (ylo / fov[1] + 0.5));
-    int yupper = ceil(nq[1] * (yhi / fov[1] + 0.5));
+    int ylower = r[2], yupper = r[3];
     if (ylower < 0) {
         cout << "Warning: y-index of quadrant < 0." << endl;
         ylower = 0;
@@ -163,56 +475,26 @@ void quadrants::add_spring_nonperiodic(spring *s, array<int, 2> fl)
     }
     if (ylower > yupper) throw std::logic_error("ylower > yupper");
 
+    // the upper edge of the box rounds to quadrant nq, which get_attach_list wraps to 0
     for (int i = xlower; i <= xupper; i++)
         for (int j = ylower; j <= yupper; j++)
-            quads[i][j].push_back(fl);
+            cells.push_back((i % nq[0]) * nq[1] + j % nq[1]);
 }
 
-void quadrants::add_spring_periodic(spring *s, array<int, 2> fl)
+void quadrants::find_cells_periodic(const array<double, 4> &b, const array<int, 4> &r, vector<int> &cells)
 {
     array<double, 2> fov = bc->get_fov();
     double delrx = bc->get_delrx();
-    vec_type h0 = s->get_h0();
-    vec_type h1 = s->get_h1();
-    array<double, 2> hx = {h0.x, h1.x};
-    array<double, 2> hy = {h0.y, h1.y};
-    vec_type disp = s->get_disp();
 
-    double xlo, xhi;
-    double ylo, yhi;
-    if (disp.y >= 0) {
-        ylo = hy[0];
-        yhi = hy[0] + disp.y;
-        if (disp.x >= 0) {
-            xlo = hx[0];
-            xhi = hx[0] + disp.x;
-        } else {
-            xlo = hx[0] + disp.x;
-            xhi = hx[0];
-        }
-    } else {
-        ylo = hy[1];
-        yhi = hy[1] - disp.y;
-        if (disp.x >= 0) {
-            xlo = hx[1] - disp.x;
-            xhi = hx[1];
-        } else {
-            xlo = hx[1];
-            xhi = hx[1] - disp.x;
-        }
-    }
-    if (xlo > xhi) throw std::logic_error("xlo > xhi");
-    if (ylo > yhi) throw std::logic_error("ylo > yhi");
-
-    int ylower = floor(nq[1] * (ylo / fov[1] + 0.5));
-    int yupper =  ceil(nq[1] * (yhi / fov[1] + 0.5));
+    int ylower = r[2];
+    int yupper = r[3];
     if (ylower > yupper) throw std::logic_error("ylower > yupper");
 
     for (int jj = ylower; jj <= yupper; jj++) {
         int j = jj;
 
-        double xlo_new = xlo;
-        double xhi_new = xhi;
+        double xlo_new = b[0];
+        double xhi_new = b[1];
         while (j < 0) {
             j += nq[1];
             xlo_new += delrx;
@@ -225,8 +507,12 @@ void quadrants::add_spring_periodic(spring *s, array<int, 2> fl)
         }
         if (!(0 <= j && j < nq[1])) throw std::logic_error("y quadrant index out of bounds");
 
-        int xlower = floor(nq[0] * (xlo_new / fov[0] + 0.5));
-        int xupper =  ceil(nq[0] * (xhi_new / fov[0] + 0.5));
+        int xlower = r[0];
+        int xupper = r[1];
+        if (j != jj) {
+            xlower = floor(nq[0] * (xlo_new / fov[0] + 0.5));
+            xupper =  ceil(nq[0] * (xhi_new / fov[0] + 0.5));
+        }
         if (xlower > xupper) throw std::logic_error("xlower > xupper");
 
         for (int ii = xlower; ii <= xupper; ii++) {
@@ -236,7 +522,7 @@ void quadrants::add_spring_periodic(spring *s, array<int, 2> fl)
             while (i >= nq[0]) i -= nq[0];
             if (!(0 <= i && i < nq[0])) throw std::logic_error("x quadrant index out of bounds");
 
-            quads[i][j].push_back(fl);
+            cells.push_back(i * nq[1] + j);
         }
     }
 }
@@ -0,0 +1,77 @@
+#include "scheduler.h"
+
+struct phase_load
+{
+    long calls;
+    double wall;
+    vector<double> busy;  // per thread
+};
+
+static const char *phase_names[load_nphases] = {"motor forces", "attach/detach", "exv"};
+static phase_load phases[load_nphases];
+
+void balanced_blocks(int n, const double *cost, int nblocks, vector<int> &bounds)
+{
+    bounds.assign(nblocks + 1, n);
+    bounds[0] = 0;
+
+    if (!cost) {
+        for (int blk = 1; blk < nblocks; blk++)
+            bounds[blk] = int((long(n) * blk) / nblocks);
+        return;
+    }
+
+    double total = 0.0;
+    for (int i = 0; i < n; i++) total += cost[i];
+
+    // block blk ends at the first item where the running cost
+    // reaches its share of the total
+    double sum = 0.0;
+    int blk = 1;
+    for (int i = 0; i < n && blk < nblocks; i++) {
+        sum += cost[i];
+        while (blk < nblocks && sum >= total * blk / nblocks) {
+            bounds[blk] = i + 1;
+            blk++;
+        }
+    }
+}
+
+int get_nblocks()
+{
+    return (get_max_threads() > 1) ? 16 * get_max_threads() : 1;
+}
+
+double wall_time()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double>(now).count();
+}
+
+void add_load(load_phase phase, double wall, const vector<double> &busy)
+{
+    // loops of the same phase can run at the same time in a task graph
+    #pragma omp critical(load_balance)
+    {
+        phase_load &load = phases[phase];
+        load.calls++;
+        load.wall += wall;
+        if (load.busy.size() < busy.size()) load.busy.resize(busy.size(), 0.0);
+        for (size_t t = 0; t < busy.size(); t++)
+            load.busy[t] += busy[t];
+    }
+}
+
+void print_load_balance(ostream &out)
+{
+    out << "Load balance (busy/idle seconds per thread):" << endl;
+    for (int p = 0; p < load_nphases; p++) {
+        phase_load &load = phases[p];
+        if (load.calls == 0) continue;
+        fmt::print(out, "  {}: {} loops, {:.4f} s\n", phase_names[p], load.calls, load.wall);
+        for (size_t t = 0; t < load.busy.size(); t++) {
+            fmt::print(out, "    thread {}: busy {:.4f} idle {:.4f}\n",
+                    t, load.busy[t], load.wall - load.busy[t]);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#include "step_control.h"
+
+constexpr double step_control::max_growth;
+constexpr double step_control::max_prob;
+
+step_control::step_control(double dt, double dt_min, double dt_max, double tol)
+{
+    if (!(dt_min > 0 && dt_min <= dt && dt <= dt_max))
+        throw runtime_error("adaptive steps need 0 < dt_min <= dt <= dt_max");
+    this->dt = dt;
+    this->dt_min = dt_min;
+    this->dt_max = dt_max;
+    this->tol = tol;
+
+    nsteps = 0;
+    nshrunk = 0;
+    ncut = 0;
+    dt_lo = infty;
+    dt_hi = 0.0;
+    elapsed = 0.0;
+}
+
+double step_control::next(double max_drift, double max_rate, double time_left)
+{
+    double target = dt_max;
+    if (max_drift > 0) target = min(target, tol / max_drift);
+    if (max_rate > 0) target = min(target, max_prob / max_rate);
+
+    double new_dt = max(dt_min, min(target, max_growth * dt));
+    if (new_dt < dt) nshrunk++;
+    dt = new_dt;
+
+    double step = dt;
+    if (time_left > 0 && time_left < step) {
+        step = time_left;
+        ncut++;
+    }
+
+    nsteps++;
+    dt_lo = min(dt_lo, step);
+    dt_hi = max(dt_hi, step);
+    elapsed += step;
+    return step;
+}
+
+void step_control::print_summary(ostream &out)
+{
+    if (nsteps == 0) return;
+    fmt::print(out, "Adaptive dt: {} steps, dt from {} to {}, mean {}, shrank {} times, cut short {} times\n",
+            nsteps, dt_lo, dt_hi, elapsed / nsteps, nshrunk, ncut);
+}
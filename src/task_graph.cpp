@@ -0,0 +1,148 @@
+#include "task_graph.h"
+#include "scheduler.h"
+
+task_graph::task_graph()
+{
+    trace_out = nullptr;
+    trace_steps = 0;
+    nruns = 0;
+    run_time = 0.0;
+    critical_time = 0.0;
+    dependency_time = 0.0;
+}
+
+int task_graph::add(string name, function<void()> run, vector<int> deps)
+{
+    int id = tasks.size();
+    int wave = 0;
+    for (int d : deps) {
+        if (d < 0 || d >= id) throw std::logic_error("task depends on a task that isn't added yet");
+        wave = max(wave, tasks[d].wave + 1);
+    }
+    tasks.push_back({name, run, deps, wave, 0.0, 0.0, 0, 0.0, 0});
+    if (int(waves.size()) <= wave) waves.resize(wave + 1);
+    waves[wave].push_back(id);
+    return id;
+}
+
+void task_graph::run()
+{
+    double start = wall_time();
+    for (const vector<int> &wave : waves) {
+        this->run_wave(wave);
+    }
+    for (task_type &task : tasks) {
+        task.start -= start;
+        task.end -= start;
+        task.time += task.end - task.start;
+    }
+    this->trace_run(0.0, wall_time() - start);
+}
+
+void task_graph::run_wave(const vector<int> &wave)
+{
+    int k = wave.size();
+    int nthreads = get_max_threads();
+
+    if (k == 1 || nthreads == 1) {
+        for (int id : wave) {
+            task_type &task = tasks[id];
+            task.nthreads = nthreads;
+            task.start = wall_time();
+            task.run();
+            task.end = wall_time();
+        }
+        return;
+    }
+
+    // each task runs on its own thread, with a share of the threads for its loops
+    int team = min(k, nthreads);
+    vector<string> errors(k);
+    set_max_active_levels(2);
+
+    #pragma omp parallel for num_threads(team) schedule(dynamic, 1)
+    for (int j = 0; j < k; j++) {
+        task_type &task = tasks[wave[j]];
+        task.nthreads = max(1, nthreads / team + (get_thread_num() < nthreads % team ? 1 : 0));
+        set_num_threads(task.nthreads);
+        task.start = wall_time();
+        try {
+            task.run();
+        } catch (exception &e) {
+            // exceptions can't leave a parallel region
+            errors[j] = e.what();
+            if (errors[j].empty()) errors[j] = "task failed";
+        }
+        task.end = wall_time();
+    }
+
+    set_max_active_levels(1);
+    for (int j = 0; j < k; j++) {
+        if (!errors[j].empty()) throw runtime_error(errors[j]);
+    }
+}
+
+void task_graph::set_trace(ostream *out, long nsteps)
+{
+    trace_out = out;
+    trace_steps = nsteps;
+    if (trace_out && trace_steps > 0)
+        *trace_out << "step\twave\ttask\tthreads\tstart\tend\tcritical\n";
+}
+
+void task_graph::trace_run(double start, double end)
+{
+    // a wave starts when the previous wave is done,
+    // so the achieved critical path is the slowest task of every wave
+    vector<bool> critical(tasks.size(), false);
+    for (const vector<int> &wave : waves) {
+        int cur = wave[0];
+        for (int id : wave) {
+            if (tasks[id].end > tasks[cur].end) cur = id;
+        }
+        task_type &task = tasks[cur];
+        critical[cur] = true;
+        task.ncritical++;
+        critical_time += task.end - task.start;
+    }
+
+    // the longest chain of dependencies is the bound for any schedule
+    vector<double> finish(tasks.size(), 0.0);
+    double longest = 0.0;
+    for (size_t id = 0; id < tasks.size(); id++) {
+        double ready = 0.0;
+        for (int d : tasks[id].deps) ready = max(ready, finish[d]);
+        finish[id] = ready + tasks[id].end - tasks[id].start;
+        longest = max(longest, finish[id]);
+    }
+    dependency_time += longest;
+
+    if (trace_out && nruns < trace_steps) {
+        for (size_t id = 0; id < tasks.size(); id++) {
+            task_type &task = tasks[id];
+            fmt::print(*trace_out, "{}\t{}\t{}\t{}\t{}\t{}\t{}\n",
+                    nruns, task.wave, task.name, task.nthreads,
+                    task.start, task.end, int(critical[id]));
+        }
+        trace_out->flush();
+    }
+
+    nruns++;
+    run_time += end - start;
+}
+
+void task_graph::print_summary(ostream &out)
+{
+    if (nruns == 0) return;
+
+    double work = 0.0;
+    for (task_type &task : tasks) work += task.time;
+
+    out << "Task graph (mean seconds per step):" << endl;
+    fmt::print(out, "  step {:.3e}\twork {:.3e}\tcritical path {:.3e}\tlongest dependency chain {:.3e}\n",
+            run_time / nruns, work / nruns, critical_time / nruns, dependency_time / nruns);
+    for (task_type &task : tasks) {
+        fmt::print(out, "  {}: wave {}\ttime {:.3e}\ton critical path {:.0f}%\n",
+                task.name, task.wave, task.time / nruns, 100.0 * task.ncritical / nruns);
+    }
+}
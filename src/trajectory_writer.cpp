@@ -0,0 +1,142 @@
+#include "trajectory_writer.h"
+#include "scheduler.h"
+
+trajectory_writer::trajectory_writer(array<ostream *, frame_nfiles> files, int depth)
+{
+    this->files = files;
+    this->depth = max(depth, 0);
+
+    // a frame being filled, and up to depth frames waiting to be written
+    frames.resize(this->depth + 1);
+    for (int i = this->depth; i >= 0; i--) free_frames.push_back(i);
+    current = -1;
+
+    done = false;
+    nframes = 0;
+    wait_time = 0.0;
+
+    if (this->depth > 0) thread = std::thread(&trajectory_writer::run, this);
+}
+
+trajectory_writer::~trajectory_writer()
+{
+    try {
+        this->finish();
+    } catch (exception &e) {
+        cerr << "\nerror writing output: " << e.what() << endl;
+    }
+}
+
+frame_type &trajectory_writer::next()
+{
+    if (current < 0) {
+        std::unique_lock<std::mutex> guard(lock);
+        if (free_frames.empty()) {
+            double start = wall_time();
+            changed.wait(guard, [this]() { return !free_frames.empty() || !error.empty(); });
+            wait_time += wall_time() - start;
+        }
+        if (!error.empty()) throw runtime_error(error);
+        current = free_frames.back();
+        free_frames.pop_back();
+    }
+    return frames[current];
+}
+
+void trajectory_writer::push()
+{
+    if (current < 0) throw std::logic_error("pushed a frame before getting one");
+    nframes++;
+
+    if (depth == 0) {
+        this->write(frames[current]);
+        free_frames.push_back(current);
+        current = -1;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queued.push_back(current);
+        current = -1;
+    }
+    changed.notify_all();
+}
+
+void trajectory_writer::run()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        changed.wait(guard, [this]() { return !queued.empty() || done; });
+        if (queued.empty()) return;
+
+        int i = queued.front();
+        guard.unlock();
+        try {
+            this->write(frames[i]);
+        } catch (exception &e) {
+            // reported by the step loop the next time it needs a frame
+            guard.lock();
+            error = e.what();
+            if (error.empty()) error = "writing a frame failed";
+            queued.clear();
+            changed.notify_all();
+            return;
+        }
+        guard.lock();
+        queued.pop_front();
+        free_frames.push_back(i);
+        changed.notify_all();
+    }
+}
+
+void trajectory_writer::finish()
+{
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            done = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+    if (!error.empty()) throw runtime_error(error);
+}
+
+static void write_rows(ostream &out, const string &time_str, const vector<double> &rows, int ncols)
+{
+    fmt::memory_buffer buf;
+    fmt::format_to(std::back_inserter(buf), "{}\tN = {}", time_str, rows.size() / ncols);
+    for (size_t i = 0; i < rows.size(); i += ncols) {
+        fmt::format_to(std::back_inserter(buf), "\n{}", rows[i]);
+        for (int j = 1; j < ncols; j++)
+            fmt::format_to(std::back_inserter(buf), "\t{}", rows[i + j]);
+    }
+    out.write(buf.data(), buf.size());
+}
+
+void trajectory_writer::write(const frame_type &frame)
+{
+    write_rows(*files[frame_beads], frame.time_str, frame.beads, 4);
+    write_rows(*files[frame_springs], frame.time_str, frame.springs, 5);
+    write_rows(*files[frame_myosins], frame.time_str, frame.myosins, 8);
+    write_rows(*files[frame_crosslks], frame.time_str, frame.crosslks, 8);
+    write_rows(*files[frame_thermo], frame.time_str, frame.thermo, 2);
+
+    fmt::memory_buffer buf;
+    for (size_t j = 0; j < frame.pe.size(); j++)
+        fmt::format_to(std::back_inserter(buf), "{}{}", frame.pe[j], (j + 1 < frame.pe.size()) ? '\t' : '\n');
+    files[frame_pe]->write(buf.data(), buf.size());
+
+    for (ostream *out : files) {
+        out->flush();
+        if (!*out) throw runtime_error("output file is not writable");
+    }
+}
+
+void trajectory_writer::print_summary(ostream &out)
+{
+    if (depth == 0) return;
+    fmt::print(out, "Output: {} frames, queue depth {}, waited {:.4f} s for the writer\n",
+            nframes, depth, wait_time);
+}